@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -30,6 +27,10 @@
 
    MODE specifies the form of output:
 
+     - Mode 0 is a one-shot: the channel's output rises to 1 when
+       its count runs out, once.  pit_configure_oneshot() uses it
+       to interrupt at a chosen time rather than periodically.
+
      - Mode 2 is a periodic pulse: the channel's output is 1 for
        most of the period, but drops to 0 briefly toward the end
        of the period.  This is useful for hooking up to an
@@ -41,6 +42,8 @@
 
      - Other modes are less useful.
 
+   This function configures mode 2 or 3.
+
    FREQUENCY is the number of periods per second, in Hz. */
 void
 pit_configure_channel (int channel, int mode, int frequency)
@@ -81,3 +84,22 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Configures the given CHANNEL, which must be channel 0, to
+   interrupt once, after COUNT cycles of the PIT's PIT_HZ clock.
+   COUNT must be between 1 and PIT_COUNT_MAX. */
+void
+pit_configure_oneshot (int channel, unsigned count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0);
+  ASSERT (count >= 1 && count <= PIT_COUNT_MAX);
+
+  /* A count of 65536 is written as 0. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
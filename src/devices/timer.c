@@ -1,5 +1,6 @@
 #include "devices/timer.h"
 #include <debug.h>
+#include <heap.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
@@ -17,14 +18,49 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Until timer_calibrate() measures the speed of the CPU's
+   time-stamp counter, the PIT interrupts periodically, once per
+   tick.  After that, it is programmed to interrupt once, at the
+   next event: the end of the current tick, or the time at which
+   a sleeping thread is to wake up, whichever comes first.  Time
+   is kept by the time-stamp counter, so sleeps can be shorter
+   than a tick, and while the idle thread runs, ticks need not
+   interrupt at all. */
+
+/* Number of timer ticks since OS booted.  While the tick is
+   stopped, only brought up to date when it restarts. */
 static int64_t ticks;
 
+/* Time-stamp counter cycles per timer tick, or 0 if not yet
+   calibrated. */
+static uint64_t cycles_per_tick;
+
+/* Time-stamp counter value at which `ticks' next increments. */
+static uint64_t next_tick_cycle;
+
+/* True while the idle thread has stopped the tick. */
+static bool tick_stopped;
+
+/* Threads sleeping in timer_sleep() and the like, ordered by the
+   time-stamp counter value at which they are to wake up.
+   Accessed only with interrupts off, since timer_interrupt()
+   wakes them. */
+static struct heap sleepers;
+
+/* Sleeps shorter than 1/SLEEP_MIN_FREQ seconds busy-wait, since
+   blocking and waking up would take about as long. */
+#define SLEEP_MIN_FREQ 10000
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static heap_less_func wakeup_less;
+static int64_t advance_ticks (void);
+static void program_timer (void);
+static void sleep_until (uint64_t wakeup);
+static int64_t wait_for_tick (void);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -36,18 +72,28 @@ void
 timer_init (void) 
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  heap_init (&sleepers, wakeup_less, NULL);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and cycles_per_tick, then starts programming the timer for
+   each event instead of interrupting periodically. */
 void
 timer_calibrate (void) 
 {
   unsigned high_bit, test_bit;
+  int64_t start_ticks, end_ticks;
+  uint64_t start_cycles;
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
 
+  /* Time the loops below with the time-stamp counter too. */
+  start_ticks = wait_for_tick ();
+  start_cycles = timer_cycles ();
+
   /* Approximate loops_per_tick as the largest power-of-two
      still less than one timer tick. */
   loops_per_tick = 1u << 10;
@@ -63,6 +109,18 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
+  /* Switch the timer over from periodic interrupts.  Do it with
+     interrupts off, since cycles_per_tick becoming nonzero tells
+     timer_interrupt() that next_tick_cycle is valid. */
+  end_ticks = wait_for_tick ();
+  old_level = intr_disable ();
+  cycles_per_tick = ((timer_cycles () - start_cycles)
+                     / (end_ticks - start_ticks));
+  ASSERT (cycles_per_tick != 0);
+  next_tick_cycle = timer_cycles () + cycles_per_tick;
+  program_timer ();
+  intr_set_level (old_level);
+
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
 }
 
@@ -84,16 +142,44 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the CPU's time-stamp counter, which counts CPU clock
+   cycles, for timing intervals much shorter than a tick.  See
+   [IA32-v2b] "RDTSC--Read Time-Stamp Counter". */
+uint64_t
+timer_cycles (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The thread blocks until timer_interrupt() wakes it, so that it
+   uses no CPU time while it sleeps. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  if (cycles_per_tick == 0)
+    {
+      /* Not calibrated yet, so we can't tell timer_interrupt()
+         when to wake us. */
+      int64_t start = timer_ticks ();
+      while (timer_elapsed (start) < ticks) 
+        thread_yield ();
+      return;
+    }
+
+  old_level = intr_disable ();
+  sleep_until (next_tick_cycle + (ticks - 1) * cycles_per_tick);
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -159,6 +245,38 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Stops the timer from interrupting at each tick, for the idle
+   thread to call just before it waits for an interrupt.  Sleeping
+   threads still wake up on time.  Interrupts must be off. */
+void
+timer_idle_enter (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cycles_per_tick != 0 && !tick_stopped)
+    {
+      tick_stopped = true;
+      program_timer ();
+    }
+}
+
+/* Restarts the tick stopped by timer_idle_enter(), for the
+   scheduler to call when it switches away from the idle thread,
+   and accounts the ticks that passed in the meantime as idle.
+   Interrupts must be off. */
+void
+timer_idle_exit (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (tick_stopped)
+    {
+      tick_stopped = false;
+      thread_idle_ticks (advance_ticks ());
+      program_timer ();
+    }
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
@@ -166,12 +284,129 @@ timer_print_stats (void)
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Brings `ticks' up to date with the time-stamp counter.
+   Returns the number of ticks that passed. */
+static int64_t
+advance_ticks (void)
+{
+  uint64_t now = timer_cycles ();
+  int64_t cnt;
+
+  if (now < next_tick_cycle)
+    return 0;
+  cnt = (now - next_tick_cycle) / cycles_per_tick + 1;
+  ticks += cnt;
+  next_tick_cycle += cnt * cycles_per_tick;
+  return cnt;
+}
+
+/* Programs the PIT to interrupt at the next event: the end of
+   the current tick, unless the tick is stopped, or the earliest
+   time at which a sleeping thread is to wake up.  If neither is
+   pending, or the next event is too far away for the PIT to
+   count, interrupts as late as it can.  Interrupts must be
+   off. */
+static void
+program_timer (void)
+{
+  uint64_t max_cycles = cycles_per_tick * TIMER_FREQ * PIT_COUNT_MAX / PIT_HZ;
+  uint64_t now = timer_cycles ();
+  uint64_t next = now + max_cycles;
+  uint64_t cycles, count;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!tick_stopped && next_tick_cycle < next)
+    next = next_tick_cycle;
+  if (!heap_empty (&sleepers))
+    {
+      struct thread *t = heap_entry (heap_min (&sleepers),
+                                     struct thread, sleep_elem);
+      if (t->wakeup_cycle < next)
+        next = t->wakeup_cycle;
+    }
+
+  /* Round up, so as not to interrupt before the event. */
+  cycles = next > now ? next - now : 0;
+  count = DIV_ROUND_UP (cycles * PIT_HZ, cycles_per_tick * TIMER_FREQ);
+  pit_configure_oneshot (0, count > 0 ? count : 1);
+}
+
+/* Blocks the running thread until the time-stamp counter reaches
+   WAKEUP.  Interrupts must be off. */
+static void
+sleep_until (uint64_t wakeup)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->wakeup_cycle = wakeup;
+  heap_insert (&sleepers, &t->sleep_elem);
+  if (heap_min (&sleepers) == &t->sleep_elem)
+    program_timer ();
+  thread_block ();
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  thread_tick ();
+  int64_t cnt;
+
+  if (cycles_per_tick == 0)
+    {
+      /* Not calibrated yet, so the PIT interrupts once per tick. */
+      ticks++;
+      thread_tick ();
+      return;
+    }
+
+  cnt = advance_ticks ();
+
+  /* Wake up sleeping threads whose time has come.  Only the
+     earliest is examined, so an interrupt with nothing to wake
+     costs O(1). */
+  while (!heap_empty (&sleepers))
+    {
+      struct thread *t = heap_entry (heap_min (&sleepers),
+                                     struct thread, sleep_elem);
+      if (t->wakeup_cycle > timer_cycles ())
+        break;
+      heap_pop_min (&sleepers);
+      thread_unblock (t);
+    }
+
+  /* Account for each tick that passed.  More than one may have
+     passed if the tick was stopped. */
+  while (cnt-- > 0)
+    thread_tick ();
+  program_timer ();
+
+  /* Run a thread we woke right away if it outranks this one. */
+  thread_preempt ();
+}
+
+/* Returns true if thread A is to wake up before thread B. */
+static bool
+wakeup_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, sleep_elem);
+  const struct thread *b = heap_entry (b_, struct thread, sleep_elem);
+
+  return a->wakeup_cycle < b->wakeup_cycle;
+}
+
+/* Waits for a timer tick and returns the new tick count.  The
+   tick must be running, that is, interrupts must be on. */
+static int64_t
+wait_for_tick (void)
+{
+  int64_t start = ticks;
+  while (ticks == start)
+    barrier ();
+  return ticks;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -180,12 +415,9 @@ static bool
 too_many_loops (unsigned loops) 
 {
   /* Wait for a timer tick. */
-  int64_t start = ticks;
-  while (ticks == start)
-    barrier ();
+  int64_t start = wait_for_tick ();
 
   /* Run LOOPS loops. */
-  start = ticks;
   busy_wait (loops);
 
   /* If the tick count changed, we iterated too long. */
@@ -220,7 +452,20 @@ real_time_sleep (int64_t num, int32_t denom)
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
-  if (ticks > 0)
+  if (cycles_per_tick != 0 && num * SLEEP_MIN_FREQ >= denom)
+    {
+      /* Block until the time-stamp counter says we're done.  The
+         timer interrupts right then, so the sleep is accurate
+         even if it is much shorter than a tick.  Scale as in
+         real_time_delay() to avoid overflow. */
+      uint64_t cycles = (cycles_per_tick * num / 1000 * TIMER_FREQ
+                         / (denom / 1000));
+      enum intr_level old_level = intr_disable ();
+
+      sleep_until (timer_cycles () + cycles);
+      intr_set_level (old_level);
+    }
+  else if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
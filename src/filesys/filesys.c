@@ -10,6 +10,9 @@
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* Serializes file system operations. */
+struct lock fs_lock;
+
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -21,7 +24,10 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  lock_init (&fs_lock);
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
 
   if (format) 
@@ -0,0 +1,48 @@
+#ifndef __LIB_HEAPSTATS_H
+#define __LIB_HEAPSTATS_H
+
+/* Kernel memory statistics, reported by the heapstats system
+   call. */
+
+/* Number of malloc() size classes, for blocks of 16 to 1024
+   bytes. */
+#define HEAP_CLASS_CNT 7
+
+/* Usage of a malloc() size class. */
+struct heap_class_stats
+  {
+    unsigned block_size;        /* Size of blocks, 0 for big blocks. */
+    unsigned blocks;            /* Blocks in use. */
+    unsigned peak_blocks;       /* Most blocks ever in use. */
+    unsigned arenas;            /* Pages held. */
+    unsigned failures;          /* Allocations that failed. */
+  };
+
+/* Usage of a page allocator pool. */
+struct heap_pool_stats
+  {
+    unsigned pages;             /* Pages in pool. */
+    unsigned used;              /* Pages in use. */
+    unsigned peak_used;         /* Most pages ever in use. */
+    unsigned failures;          /* Allocations that failed. */
+  };
+
+/* Kernel heap statistics. */
+struct heapstats
+  {
+    struct heap_class_stats classes[HEAP_CLASS_CNT];
+    struct heap_class_stats big;        /* Blocks of a page or more. */
+    struct heap_pool_stats kernel_pool;
+    struct heap_pool_stats user_pool;
+  };
+
+/* Memory attributed to an allocation-site tag. */
+struct heap_tag_stats
+  {
+    char name[16];              /* Tag name, possibly truncated. */
+    unsigned blocks;            /* Objects allocated. */
+    unsigned bytes;             /* Bytes allocated. */
+    unsigned peak_bytes;        /* Most bytes ever allocated. */
+  };
+
+#endif /* lib/heapstats.h */
@@ -68,6 +68,58 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns a mask of the CNT bits, which must not be zero,
+   starting at bit OFS within an element. */
+static inline elem_type
+run_mask (size_t ofs, size_t cnt)
+{
+  elem_type mask = (elem_type) -1;
+  if (cnt < ELEM_BITS)
+    mask = ((elem_type) 1 << cnt) - 1;
+  return mask << ofs;
+}
+
+/* Returns the number of 1-bits in X, counting bits in parallel
+   within progressively wider fields. */
+static inline unsigned
+popcount (elem_type x)
+{
+  const elem_type ones = (elem_type) -1;
+
+  x -= (x >> 1) & (ones / 3);
+  x = (x & (ones / 15 * 3)) + ((x >> 2) & (ones / 15 * 3));
+  x = (x + (x >> 4)) & (ones / 255 * 15);
+  return (elem_type) (x * (ones / 255)) >> (ELEM_BITS - CHAR_BIT);
+}
+
+/* Returns the index of the first bit in B at or after START and
+   before END that is set to VALUE, or END if there is none.
+   Works a whole element at a time, finding the bit within an
+   element with the "bsf" instruction. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value)
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+  size_t idx;
+
+  if (start >= end)
+    return end;
+  idx = elem_idx (start);
+  for (;;)
+    {
+      elem_type bits = b->bits[idx] ^ flip;
+      if (idx == elem_idx (start))
+        bits &= ~(bit_mask (start) - 1);
+      if (bits != 0)
+        {
+          size_t found = idx * ELEM_BITS + __builtin_ctzl (bits);
+          return found < end ? found : end;
+        }
+      if (++idx * ELEM_BITS >= end)
+        return end;
+    }
+}
 
 /* Creation and destruction. */
 
@@ -217,14 +269,27 @@ bitmap_set_all (struct bitmap *b, bool value)
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
+  size_t end = start + cnt;
+
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  /* Set the bits in each element at once, atomically, as in
+     bitmap_mark() and bitmap_reset(). */
+  while (start < end)
+    {
+      size_t idx = elem_idx (start);
+      size_t ofs = start % ELEM_BITS;
+      size_t n = ELEM_BITS - ofs < end - start ? ELEM_BITS - ofs : end - start;
+      elem_type mask = run_mask (ofs, n);
+
+      if (value)
+        asm ("orl %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
+      start += n;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -232,17 +297,24 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t end = start + cnt;
+  size_t set_cnt;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
-  return value_cnt;
+  set_cnt = 0;
+  while (start < end)
+    {
+      size_t idx = elem_idx (start);
+      size_t ofs = start % ELEM_BITS;
+      size_t n = ELEM_BITS - ofs < end - start ? ELEM_BITS - ofs : end - start;
+
+      set_cnt += popcount (b->bits[idx] & run_mask (ofs, n));
+      start += n;
+    }
+  return value ? set_cnt : cnt - set_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -250,16 +322,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -301,10 +368,26 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+
+      if (cnt == 0)
+        return start;
+
+      /* Find the start of a run of VALUE bits, then its end.  If
+         the run is too short, the next run can start no earlier
+         than the bit that ended it. */
+      while (i <= last)
+        {
+          size_t stop;
+
+          i = find_bit (b, i, last + 1, value);
+          if (i > last)
+            break;
+          stop = find_bit (b, i, i + cnt, !value);
+          if (stop == i + cnt)
+            return i;
+          i = stop;
+        }
     }
   return BITMAP_ERROR;
 }
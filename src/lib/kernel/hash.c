@@ -18,6 +18,8 @@ static struct hash_elem *find_elem (struct hash *, struct list *,
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
 static void rehash (struct hash *);
+static size_t total_buckets (const struct hash *);
+static struct list *bucket_at (struct hash *, size_t idx);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -28,6 +30,9 @@ hash_init (struct hash *h,
   h->elem_cnt = 0;
   h->bucket_cnt = 4;
   h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+  h->moved_cnt = 0;
   h->hash = hash;
   h->less = less;
   h->aux = aux;
@@ -55,9 +60,9 @@ hash_clear (struct hash *h, hash_action_func *destructor)
 {
   size_t i;
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  for (i = 0; i < total_buckets (h); i++) 
     {
-      struct list *bucket = &h->buckets[i];
+      struct list *bucket = bucket_at (h, i);
 
       if (destructor != NULL) 
         while (!list_empty (bucket)) 
@@ -70,6 +75,8 @@ hash_clear (struct hash *h, hash_action_func *destructor)
       list_init (bucket); 
     }    
 
+  free (h->old_buckets);
+  h->old_buckets = NULL;
   h->elem_cnt = 0;
 }
 
@@ -89,6 +96,7 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
   if (destructor != NULL)
     hash_clear (h, destructor);
   free (h->buckets);
+  free (h->old_buckets);
 }
 
 /* Inserts NEW into hash table H and returns a null pointer, if
@@ -166,9 +174,9 @@ hash_apply (struct hash *h, hash_action_func *action)
   
   ASSERT (action != NULL);
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  for (i = 0; i < total_buckets (h); i++) 
     {
-      struct list *bucket = &h->buckets[i];
+      struct list *bucket = bucket_at (h, i);
       struct list_elem *elem, *next;
 
       for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) 
@@ -203,7 +211,8 @@ hash_first (struct hash_iterator *i, struct hash *h)
   ASSERT (h != NULL);
 
   i->hash = h;
-  i->bucket = i->hash->buckets;
+  i->bucket_idx = 0;
+  i->bucket = bucket_at (h, 0);
   i->elem = list_elem_to_hash_elem (list_head (i->bucket));
 }
 
@@ -223,11 +232,12 @@ hash_next (struct hash_iterator *i)
   i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
   while (i->elem == list_elem_to_hash_elem (list_end (i->bucket)))
     {
-      if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt)
+      if (++i->bucket_idx >= total_buckets (i->hash))
         {
           i->elem = NULL;
           break;
         }
+      i->bucket = bucket_at (i->hash, i->bucket_idx);
       i->elem = list_elem_to_hash_elem (list_begin (i->bucket));
     }
   
@@ -301,12 +311,45 @@ hash_int (int i)
   return hash_bytes (&i, sizeof i);
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Returns the bucket in H that E belongs in.  While H is being
+   rehashed, that is an old bucket if E's old bucket has not yet
+   been emptied. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-  return &h->buckets[bucket_idx];
+  unsigned hash = h->hash (e, h->aux);
+
+  if (h->old_buckets != NULL)
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->moved_cnt)
+        return &h->old_buckets[old_idx];
+    }
+  return &h->buckets[hash & (h->bucket_cnt - 1)];
+}
+
+/* Returns the number of buckets in H that may hold elements:
+   all of the current buckets, plus any old buckets that have
+   not yet been emptied. */
+static size_t
+total_buckets (const struct hash *h)
+{
+  size_t cnt = h->bucket_cnt;
+  if (h->old_buckets != NULL)
+    cnt += h->old_bucket_cnt - h->moved_cnt;
+  return cnt;
+}
+
+/* Returns bucket IDX in H, counting the current buckets first
+   and then the old buckets that have not yet been emptied. */
+static struct list *
+bucket_at (struct hash *h, size_t idx)
+{
+  ASSERT (idx < total_buckets (h));
+  if (idx < h->bucket_cnt)
+    return &h->buckets[idx];
+  else
+    return &h->old_buckets[h->moved_cnt + (idx - h->bucket_cnt)];
 }
 
 /* Searches BUCKET in H for a hash element equal to E.  Returns
@@ -344,22 +387,66 @@ is_power_of_2 (size_t x)
 #define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
 #define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
 
-/* Changes the number of buckets in hash table H to match the
+/* Number of old buckets emptied by each operation that modifies
+   a table being rehashed.  At least 2, so that rehashing always
+   finishes before the table needs to be resized again. */
+#define REHASH_STEP 2
+
+/* Moves the elements of up to REHASH_STEP old buckets in H into
+   the current buckets, and frees the old buckets once they are
+   all empty. */
+static void
+move_buckets (struct hash *h) 
+{
+  size_t i;
+
+  for (i = 0; i < REHASH_STEP && h->moved_cnt < h->old_bucket_cnt; i++) 
+    {
+      /* Count the bucket as moved first, so that find_bucket()
+         returns a current bucket for its elements. */
+      struct list *old_bucket = &h->old_buckets[h->moved_cnt++];
+
+      while (!list_empty (old_bucket)) 
+        {
+          struct list_elem *elem = list_pop_front (old_bucket);
+          list_push_front (find_bucket (h, list_elem_to_hash_elem (elem)),
+                           elem);
+        }
+    }
+
+  if (h->moved_cnt >= h->old_bucket_cnt) 
+    {
+      free (h->old_buckets);
+      h->old_buckets = NULL;
+    }
+}
+
+/* If hash table H is being rehashed, continues rehashing it.
+   Otherwise, if H has too few or too many buckets for its
+   elements, starts changing the number of buckets to match the
    ideal.  This function can fail because of an out-of-memory
    condition, but that'll just make hash accesses less efficient;
    we can still continue. */
 static void
 rehash (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
+  size_t new_bucket_cnt;
+  struct list *new_buckets;
   size_t i;
 
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
+  if (h->old_buckets != NULL) 
+    {
+      move_buckets (h);
+      return;
+    }
+
+  /* Don't do anything unless the number of elements per bucket
+     has left the acceptable range. */
+  if (h->elem_cnt <= h->bucket_cnt * MAX_ELEMS_PER_BUCKET
+      && h->elem_cnt >= h->bucket_cnt * MIN_ELEMS_PER_BUCKET)
+    return;
 
   /* Calculate the number of buckets to use now.
      We want one bucket for about every BEST_ELEMS_PER_BUCKET.
@@ -372,7 +459,7 @@ rehash (struct hash *h)
     new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
 
   /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
+  if (new_bucket_cnt == h->bucket_cnt)
     return;
 
   /* Allocate new buckets and initialize them as empty. */
@@ -387,29 +474,14 @@ rehash (struct hash *h)
   for (i = 0; i < new_bucket_cnt; i++) 
     list_init (&new_buckets[i]);
 
-  /* Install new bucket info. */
+  /* Install new bucket info, keeping the old buckets until their
+     elements have all been moved. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->moved_cnt = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
-
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
-    {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
-
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
-        {
-          struct list *new_bucket
-            = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
-          list_push_front (new_bucket, elem);
-        }
-    }
-
-  free (old_buckets);
+  move_buckets (h);
 }
 
 /* Inserts E into BUCKET (in hash table H). */
@@ -428,3 +500,151 @@ remove_elem (struct hash *h, struct hash_elem *e)
   list_remove (&e->list_elem);
 }
 
+
+/* Open-addressing hash table.
+
+   Entries are kept in an array of slots, a power of 2 in number,
+   with linear probing: an entry is stored in the first free slot
+   at or after the slot its key hashes to.  A deleted entry is
+   filled by shifting later entries of the same probe sequence
+   back, so that no "deleted" markers are needed.  The table is
+   doubled when it becomes 3/4 full. */
+
+/* Initial number of slots. */
+#define OHASH_MIN_SLOTS 16
+
+/* Returns the slot that KEY hashes to in H. */
+static size_t
+ohash_home (const struct ohash *h, uintptr_t key)
+{
+  return hash_bytes (&key, sizeof key) & (h->slot_cnt - 1);
+}
+
+/* Returns the slot in H that holds KEY, or the free slot at
+   which KEY would be inserted if it is not present. */
+static size_t
+ohash_probe (const struct ohash *h, uintptr_t key)
+{
+  size_t i = ohash_home (h, key);
+
+  while (h->slots[i].value != NULL && h->slots[i].key != key)
+    i = (i + 1) & (h->slot_cnt - 1);
+  return i;
+}
+
+/* Allocates SLOT_CNT free slots for H.
+   Returns true if successful, false on allocation failure. */
+static bool
+ohash_alloc (struct ohash *h, size_t slot_cnt)
+{
+  h->slots = calloc (slot_cnt, sizeof *h->slots);
+  if (h->slots == NULL)
+    return false;
+  h->slot_cnt = slot_cnt;
+  return true;
+}
+
+/* Initializes open-addressing hash table H as empty.
+   Returns true if successful, false on allocation failure. */
+bool
+ohash_init (struct ohash *h)
+{
+  h->elem_cnt = 0;
+  return ohash_alloc (h, OHASH_MIN_SLOTS);
+}
+
+/* Destroys H.  The values it refers to are not freed. */
+void
+ohash_destroy (struct ohash *h)
+{
+  free (h->slots);
+}
+
+/* Doubles the number of slots in H.
+   Returns true if successful, false on allocation failure. */
+static bool
+ohash_grow (struct ohash *h)
+{
+  struct ohash_entry *old_slots = h->slots;
+  size_t old_slot_cnt = h->slot_cnt;
+  size_t i;
+
+  if (!ohash_alloc (h, old_slot_cnt * 2))
+    return false;
+  for (i = 0; i < old_slot_cnt; i++)
+    if (old_slots[i].value != NULL)
+      h->slots[ohash_probe (h, old_slots[i].key)] = old_slots[i];
+  free (old_slots);
+  return true;
+}
+
+/* Maps KEY to VALUE, which must not be null, in H, replacing any
+   existing mapping for KEY.  Returns true if successful, false
+   if memory for a larger table is not available. */
+bool
+ohash_insert (struct ohash *h, uintptr_t key, void *value)
+{
+  size_t i;
+
+  ASSERT (value != NULL);
+
+  i = ohash_probe (h, key);
+  if (h->slots[i].value == NULL)
+    {
+      if ((h->elem_cnt + 1) * 4 > h->slot_cnt * 3)
+        {
+          if (!ohash_grow (h))
+            return false;
+          i = ohash_probe (h, key);
+        }
+      h->elem_cnt++;
+    }
+  h->slots[i].key = key;
+  h->slots[i].value = value;
+  return true;
+}
+
+/* Returns the value that KEY maps to in H, or a null pointer if
+   there is none. */
+void *
+ohash_find (const struct ohash *h, uintptr_t key)
+{
+  return h->slots[ohash_probe (h, key)].value;
+}
+
+/* Removes the mapping for KEY from H and returns its value, or
+   returns a null pointer if there was none. */
+void *
+ohash_delete (struct ohash *h, uintptr_t key)
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t hole = ohash_probe (h, key);
+  void *value = h->slots[hole].value;
+  size_t i;
+
+  if (value == NULL)
+    return NULL;
+
+  /* Move back each following entry of the probe sequence that
+     may fill the hole, that is, whose home slot is not between
+     the hole and the entry itself. */
+  for (i = (hole + 1) & mask; h->slots[i].value != NULL; i = (i + 1) & mask)
+    {
+      size_t home = ohash_home (h, h->slots[i].key);
+      if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+          h->slots[hole] = h->slots[i];
+          hole = i;
+        }
+    }
+  h->slots[hole].value = NULL;
+  h->elem_cnt--;
+  return value;
+}
+
+/* Returns the number of keys in H. */
+size_t
+ohash_size (const struct ohash *h)
+{
+  return h->elem_cnt;
+}
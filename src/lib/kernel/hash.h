@@ -18,7 +18,18 @@
    conversion from a struct hash_elem back to a structure object
    that contains it.  This is the same technique used in the
    linked list implementation.  Refer to lib/kernel/list.h for a
-   detailed explanation. */
+   detailed explanation.
+
+   When the number of buckets changes, elements are moved from
+   the old buckets to the new ones a few buckets at a time, by
+   each operation that modifies the table, so that no single
+   operation takes time proportional to the size of the table.
+
+   For small fixed-size entries, this file also provides `struct
+   ohash', a table that maps integer keys to pointers using open
+   addressing.  Its entries are stored in the table itself, so it
+   needs no hash_elem and looking up a key does not chase a
+   pointer per probe. */
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -61,6 +72,9 @@ struct hash
     size_t elem_cnt;            /* Number of elements in table. */
     size_t bucket_cnt;          /* Number of buckets, a power of 2. */
     struct list *buckets;       /* Array of `bucket_cnt' lists. */
+    struct list *old_buckets;   /* Buckets being emptied, or null. */
+    size_t old_bucket_cnt;      /* Number of old buckets. */
+    size_t moved_cnt;           /* Old buckets already emptied. */
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
@@ -70,6 +84,7 @@ struct hash
 struct hash_iterator 
   {
     struct hash *hash;          /* The hash table. */
+    size_t bucket_idx;          /* Index of current bucket. */
     struct list *bucket;        /* Current bucket. */
     struct hash_elem *elem;     /* Current hash element in current bucket. */
   };
@@ -100,4 +115,27 @@ unsigned hash_bytes (const void *, size_t);
 unsigned hash_string (const char *);
 unsigned hash_int (int);
 
+/* Open-addressing hash table entry. */
+struct ohash_entry
+  {
+    uintptr_t key;              /* Key. */
+    void *value;                /* Value, or null if entry is free. */
+  };
+
+/* Open-addressing hash table, mapping integer keys to non-null
+   pointers. */
+struct ohash
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct ohash_entry *slots;  /* Array of `slot_cnt' entries. */
+  };
+
+bool ohash_init (struct ohash *);
+void ohash_destroy (struct ohash *);
+bool ohash_insert (struct ohash *, uintptr_t key, void *value);
+void *ohash_find (const struct ohash *, uintptr_t key);
+void *ohash_delete (struct ohash *, uintptr_t key);
+size_t ohash_size (const struct ohash *);
+
 #endif /* lib/kernel/hash.h */
@@ -0,0 +1,233 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* The heap is a complete binary tree: every level is full except
+   perhaps the last, which is filled from the left.  Numbering
+   the elements from 1 in level order, element N's children are
+   elements 2N and 2N + 1, so the bits of N after its leading 1
+   spell out the path from the root to N, with 0 for left and 1
+   for right.  That lets us find the last element, where a new
+   element goes or from which a removed element is replaced,
+   without an array.
+
+   Each element is no less than its parent, so the root is the
+   least element. */
+
+/* Initializes HEAP as an empty heap whose elements are ordered
+   by LESS given auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux)
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->elem_cnt = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Returns element number N, counting from 1 in level order, in
+   HEAP, which must have at least N elements. */
+static struct heap_elem *
+elem_at (const struct heap *heap, size_t n)
+{
+  struct heap_elem *e = heap->root;
+  int bit;
+
+  ASSERT (n >= 1 && n <= heap->elem_cnt);
+
+  for (bit = (int) (sizeof n * 8) - 1; (n >> bit) == 0; bit--)
+    continue;
+  while (--bit >= 0)
+    e = (n >> bit) & 1 ? e->right : e->left;
+  return e;
+}
+
+/* Makes NEW take OLD's place as a child of OLD's parent in HEAP,
+   or as HEAP's root. */
+static void
+replace_child (struct heap *heap, struct heap_elem *old,
+               struct heap_elem *new)
+{
+  struct heap_elem *parent = old->parent;
+
+  if (parent == NULL)
+    heap->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+  new->parent = parent;
+}
+
+/* Exchanges the positions of E and its parent in HEAP. */
+static void
+swap_with_parent (struct heap *heap, struct heap_elem *e)
+{
+  struct heap_elem *parent = e->parent;
+  struct heap_elem *left = e->left;
+  struct heap_elem *right = e->right;
+
+  replace_child (heap, parent, e);
+  if (parent->left == e)
+    {
+      e->left = parent;
+      e->right = parent->right;
+      if (e->right != NULL)
+        e->right->parent = e;
+    }
+  else
+    {
+      e->right = parent;
+      e->left = parent->left;
+      if (e->left != NULL)
+        e->left->parent = e;
+    }
+  parent->parent = e;
+
+  parent->left = left;
+  if (left != NULL)
+    left->parent = parent;
+  parent->right = right;
+  if (right != NULL)
+    right->parent = parent;
+}
+
+/* Moves E up HEAP while it is less than its parent. */
+static void
+sift_up (struct heap *heap, struct heap_elem *e)
+{
+  while (e->parent != NULL && heap->less (e, e->parent, heap->aux))
+    swap_with_parent (heap, e);
+}
+
+/* Moves E down HEAP while one of its children is less than it. */
+static void
+sift_down (struct heap *heap, struct heap_elem *e)
+{
+  for (;;)
+    {
+      struct heap_elem *child = e->left;
+
+      if (child == NULL)
+        break;
+      if (e->right != NULL && heap->less (e->right, child, heap->aux))
+        child = e->right;
+      if (!heap->less (child, e, heap->aux))
+        break;
+      swap_with_parent (heap, child);
+    }
+}
+
+/* Inserts E into HEAP. */
+void
+heap_insert (struct heap *heap, struct heap_elem *e)
+{
+  size_t n;
+
+  ASSERT (heap != NULL);
+  ASSERT (e != NULL);
+
+  /* Add E as the new last element, number N. */
+  e->left = e->right = NULL;
+  n = heap->elem_cnt + 1;
+  if (n == 1)
+    {
+      e->parent = NULL;
+      heap->root = e;
+    }
+  else
+    {
+      struct heap_elem *parent = elem_at (heap, n / 2);
+      if (n % 2 == 0)
+        parent->left = e;
+      else
+        parent->right = e;
+      e->parent = parent;
+    }
+  heap->elem_cnt = n;
+
+  sift_up (heap, e);
+}
+
+/* Removes E, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *e)
+{
+  struct heap_elem *last;
+
+  ASSERT (heap != NULL);
+  ASSERT (e != NULL);
+  ASSERT (heap->elem_cnt > 0);
+
+  /* Unlink the last element. */
+  last = elem_at (heap, heap->elem_cnt);
+  if (last->parent == NULL)
+    heap->root = NULL;
+  else if (last->parent->left == last)
+    last->parent->left = NULL;
+  else
+    last->parent->right = NULL;
+  heap->elem_cnt--;
+  if (last == e)
+    return;
+
+  /* Put it in E's place, then move it up or down to where it
+     belongs. */
+  replace_child (heap, e, last);
+  last->left = e->left;
+  if (last->left != NULL)
+    last->left->parent = last;
+  last->right = e->right;
+  if (last->right != NULL)
+    last->right->parent = last;
+  heap_update (heap, last);
+}
+
+/* Removes and returns the least element in HEAP, or returns a
+   null pointer if HEAP is empty. */
+struct heap_elem *
+heap_pop_min (struct heap *heap)
+{
+  struct heap_elem *e = heap->root;
+  if (e != NULL)
+    heap_remove (heap, e);
+  return e;
+}
+
+/* Moves E, which must be in HEAP, to its proper position after
+   its value has changed. */
+void
+heap_update (struct heap *heap, struct heap_elem *e)
+{
+  ASSERT (heap != NULL);
+  ASSERT (e != NULL);
+
+  if (e->parent != NULL && heap->less (e, e->parent, heap->aux))
+    sift_up (heap, e);
+  else
+    sift_down (heap, e);
+}
+
+/* Returns the least element in HEAP, or a null pointer if HEAP
+   is empty. */
+struct heap_elem *
+heap_min (const struct heap *heap)
+{
+  return heap->root;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap)
+{
+  return heap->elem_cnt;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap)
+{
+  return heap->root == NULL;
+}
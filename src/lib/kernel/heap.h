@@ -0,0 +1,99 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Binary min-heap.
+
+   A heap keeps track of the least of a set of elements: finding
+   it takes O(1) time, and inserting or removing any element
+   takes O(log n) time in a heap of n elements.  Unlike a
+   red-black tree, a heap does not keep its other elements in
+   order, which makes it a little cheaper when only the least
+   element is of interest, as with timers and priority queues.
+
+   Like lists and hash tables, this heap does not allocate
+   memory.  Each structure that can be in a heap must embed a
+   `struct heap_elem' member, and heap_entry() converts a pointer
+   to it back to a pointer to the structure.  For example:
+
+      struct foo
+        {
+          struct heap_elem elem;
+          int64_t deadline;
+          ...other members...
+        };
+
+      static bool
+      foo_less (const struct heap_elem *a, const struct heap_elem *b,
+                void *aux UNUSED)
+      {
+        return (heap_entry (a, struct foo, elem)->deadline
+                < heap_entry (b, struct foo, elem)->deadline);
+      }
+
+      struct heap foo_heap;
+
+      heap_init (&foo_heap, foo_less, NULL);
+      ...
+      while (!heap_empty (&foo_heap))
+        {
+          struct foo *f = heap_entry (heap_pop_min (&foo_heap),
+                                      struct foo, elem);
+          ...do something with f, in increasing order of deadline...
+        }
+
+   The heap is a complete binary tree linked through its
+   elements, rather than an array, so that it never needs to
+   grow.  Elements that compare equal come out in no particular
+   order. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *parent;   /* Parent, or null for the root. */
+    struct heap_elem *left;     /* Left child, or null. */
+    struct heap_elem *right;    /* Right child, or null. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element.  See the big comment at the top of the
+   file for an example. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)                   \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->parent           \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Binary min-heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Least element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in heap. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void heap_insert (struct heap *, struct heap_elem *);
+void heap_remove (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop_min (struct heap *);
+void heap_update (struct heap *, struct heap_elem *);
+
+/* Properties. */
+struct heap_elem *heap_min (const struct heap *);
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -0,0 +1,448 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* A red-black tree is a binary search tree in which every
+   element is colored red or black, subject to two rules:
+
+     1. A red element has no red child.
+
+     2. Every path from an element down to a missing child passes
+        through the same number of black elements.
+
+   Together these keep the longest path from the root no more
+   than twice as long as the shortest, so the height of a tree
+   of n elements is at most 2 log2 (n + 1).  Insertion and
+   removal restore the rules after changing the tree by
+   recoloring and "rotating" a few elements along a single path
+   from the changed element toward the root.
+
+   Missing children are represented by null pointers, which
+   count as black.  The root is always black. */
+
+/* Returns true if E is a red element, false if it is black or
+   null. */
+static inline bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Initializes TREE as an empty tree whose elements are ordered
+   by LESS given auxiliary data AUX. */
+void
+rb_init (struct rbtree *tree, rb_less_func *less, void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->elem_cnt = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Makes NEW take OLD's place as a child of OLD's parent in TREE,
+   or as TREE's root.  NEW may be null. */
+static void
+replace_child (struct rbtree *tree, struct rb_elem *old,
+               struct rb_elem *new)
+{
+  struct rb_elem *parent = old->parent;
+
+  if (parent == NULL)
+    tree->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+  if (new != NULL)
+    new->parent = parent;
+}
+
+/* Rotates E's right child up into E's place in TREE, making E
+   its left child:
+
+          E                R
+         / \              / \
+        a   R     =>     E   c
+           / \          / \
+          b   c        a   b
+*/
+static void
+rotate_left (struct rbtree *tree, struct rb_elem *e)
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  replace_child (tree, e, r);
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates E's left child up into E's place in TREE, making E
+   its right child.  The mirror image of rotate_left(). */
+static void
+rotate_right (struct rbtree *tree, struct rb_elem *e)
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  replace_child (tree, e, l);
+  l->right = e;
+  e->parent = l;
+}
+
+/* Inserts E into TREE, after any elements equal to it. */
+void
+rb_insert (struct rbtree *tree, struct rb_elem *e)
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &tree->root;
+
+  ASSERT (tree != NULL);
+  ASSERT (e != NULL);
+
+  /* Find E's place at the bottom of the tree and link it in, as
+     a red element, which cannot break rule 2. */
+  while (*link != NULL)
+    {
+      parent = *link;
+      link = (tree->less (e, parent, tree->aux)
+              ? &parent->left : &parent->right);
+    }
+  *link = e;
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  tree->elem_cnt++;
+
+  /* While E and its parent are both red, breaking rule 1, fix up
+     the tree.  The grandparent G must exist and be black, since
+     the root is black. */
+  while (is_red (parent = e->parent))
+    {
+      struct rb_elem *g = parent->parent;
+
+      if (parent == g->left)
+        {
+          struct rb_elem *uncle = g->right;
+          if (is_red (uncle))
+            {
+              /* Push G's blackness down to both its children,
+                 and continue from G, which is now red. */
+              parent->red = uncle->red = false;
+              g->red = true;
+              e = g;
+            }
+          else
+            {
+              /* Rotate so that E's red parent can take G's place
+                 as a black element with two red children. */
+              if (e == parent->right)
+                {
+                  rotate_left (tree, parent);
+                  parent = e;
+                }
+              parent->red = false;
+              g->red = true;
+              rotate_right (tree, g);
+              break;
+            }
+        }
+      else
+        {
+          struct rb_elem *uncle = g->left;
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              g->red = true;
+              e = g;
+            }
+          else
+            {
+              if (e == parent->left)
+                {
+                  rotate_right (tree, parent);
+                  parent = e;
+                }
+              parent->red = false;
+              g->red = true;
+              rotate_left (tree, g);
+              break;
+            }
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores rule 2 in TREE after a black element was removed from
+   the paths through E, a child of PARENT.  E may be null, so its
+   parent is passed separately. */
+static void
+remove_fixup (struct rbtree *tree, struct rb_elem *e, struct rb_elem *parent)
+{
+  /* Paths through E are one black element short.  If E is red,
+     making it black fixes that.  Otherwise, borrow a black
+     element from E's sibling's side, or make the sibling's side
+     short too and move up a level. */
+  while (e != tree->root && !is_red (e))
+    {
+      if (e == parent->left)
+        {
+          struct rb_elem *sibling = parent->right;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->right))
+                {
+                  sibling->left->red = false;
+                  sibling->red = true;
+                  rotate_right (tree, sibling);
+                  sibling = parent->right;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->right->red = false;
+              rotate_left (tree, parent);
+              e = tree->root;
+            }
+        }
+      else
+        {
+          struct rb_elem *sibling = parent->left;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+            }
+          else
+            {
+              if (!is_red (sibling->left))
+                {
+                  sibling->right->red = false;
+                  sibling->red = true;
+                  rotate_left (tree, sibling);
+                  sibling = parent->left;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->left->red = false;
+              rotate_right (tree, parent);
+              e = tree->root;
+            }
+        }
+    }
+  if (e != NULL)
+    e->red = false;
+}
+
+/* Removes E, which must be in TREE, from TREE. */
+void
+rb_remove (struct rbtree *tree, struct rb_elem *e)
+{
+  struct rb_elem *child, *parent;
+  bool removed_red;
+
+  ASSERT (tree != NULL);
+  ASSERT (e != NULL);
+  ASSERT (tree->elem_cnt > 0);
+
+  if (e->left == NULL || e->right == NULL)
+    {
+      /* E has at most one child, which takes its place. */
+      child = e->left != NULL ? e->left : e->right;
+      parent = e->parent;
+      removed_red = e->red;
+      replace_child (tree, e, child);
+    }
+  else
+    {
+      /* E has two children.  Its successor S, the leftmost element
+         in its right subtree, has no left child.  Move S into E's
+         place, with E's color, so that in effect S's old position
+         is the one removed. */
+      struct rb_elem *s = e->right;
+
+      while (s->left != NULL)
+        s = s->left;
+      child = s->right;
+      removed_red = s->red;
+      if (s->parent == e)
+        parent = s;
+      else
+        {
+          parent = s->parent;
+          replace_child (tree, s, child);
+          s->right = e->right;
+          s->right->parent = s;
+        }
+      replace_child (tree, e, s);
+      s->left = e->left;
+      s->left->parent = s;
+      s->red = e->red;
+    }
+  tree->elem_cnt--;
+
+  if (!removed_red)
+    remove_fixup (tree, child, parent);
+}
+
+/* Removes and returns the first element in TREE, or returns a
+   null pointer if TREE is empty. */
+struct rb_elem *
+rb_pop_first (struct rbtree *tree)
+{
+  struct rb_elem *e = rb_first (tree);
+  if (e != NULL)
+    rb_remove (tree, e);
+  return e;
+}
+
+/* Returns the first element in TREE that is not less than KEY,
+   or a null pointer if there is none. */
+struct rb_elem *
+rb_lower_bound (struct rbtree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (e, key, tree->aux))
+      e = e->right;
+    else
+      {
+        bound = e;
+        e = e->left;
+      }
+  return bound;
+}
+
+/* Returns the first element in TREE that is greater than KEY, or
+   a null pointer if there is none. */
+struct rb_elem *
+rb_upper_bound (struct rbtree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (key, e, tree->aux))
+      {
+        bound = e;
+        e = e->left;
+      }
+    else
+      e = e->right;
+  return bound;
+}
+
+/* Returns the first element in TREE equal to KEY, or a null
+   pointer if there is none. */
+struct rb_elem *
+rb_find (struct rbtree *tree, const struct rb_elem *key)
+{
+  struct rb_elem *e = rb_lower_bound (tree, key);
+  return e != NULL && !tree->less (key, e, tree->aux) ? e : NULL;
+}
+
+/* Returns the first element in TREE, or a null pointer if TREE
+   is empty. */
+struct rb_elem *
+rb_first (struct rbtree *tree)
+{
+  struct rb_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->left != NULL)
+      e = e->left;
+  return e;
+}
+
+/* Returns the last element in TREE, or a null pointer if TREE is
+   empty. */
+struct rb_elem *
+rb_last (struct rbtree *tree)
+{
+  struct rb_elem *e = tree->root;
+
+  if (e != NULL)
+    while (e->right != NULL)
+      e = e->right;
+  return e;
+}
+
+/* Returns the element after E in its tree, or a null pointer if
+   E is the last element. */
+struct rb_elem *
+rb_next (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL)
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return e;
+    }
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the element before E in its tree, or a null pointer if
+   E is the first element. */
+struct rb_elem *
+rb_prev (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->left != NULL)
+    {
+      e = e->left;
+      while (e->right != NULL)
+        e = e->right;
+      return e;
+    }
+  while (e->parent != NULL && e == e->parent->left)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rbtree *tree)
+{
+  return tree->elem_cnt;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rbtree *tree)
+{
+  return tree->root == NULL;
+}
@@ -0,0 +1,109 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A red-black tree is a binary search tree that keeps itself
+   balanced, so that inserting, removing, and finding an element
+   take O(log n) time in a tree of n elements, and so does
+   stepping to the next or previous element in order.
+
+   Like lists and hash tables, this tree does not allocate
+   memory.  Each structure that can be in a tree must embed a
+   `struct rb_elem' member, and rb_entry() converts a pointer to
+   it back to a pointer to the structure.  For example:
+
+      struct foo
+        {
+          struct rb_elem elem;
+          int64_t key;
+          ...other members...
+        };
+
+      static bool
+      foo_less (const struct rb_elem *a, const struct rb_elem *b,
+                void *aux UNUSED)
+      {
+        return (rb_entry (a, struct foo, elem)->key
+                < rb_entry (b, struct foo, elem)->key);
+      }
+
+      struct rbtree foo_tree;
+      struct rb_elem *e;
+
+      rb_init (&foo_tree, foo_less, NULL);
+      ...
+      for (e = rb_first (&foo_tree); e != NULL; e = rb_next (e))
+        {
+          struct foo *f = rb_entry (e, struct foo, elem);
+          ...do something with f, in increasing order of key...
+        }
+
+   A tree may hold several elements that compare equal.  Each is
+   inserted after those already in the tree, so that elements
+   with equal keys come out in first-in, first-out order.
+
+   Unlike with lists, the end of an iteration is a null pointer,
+   since a tree has no head or tail element. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree element. */
+struct rb_elem
+  {
+    struct rb_elem *parent;     /* Parent, or null for the root. */
+    struct rb_elem *left;       /* Left child, or null. */
+    struct rb_elem *right;      /* Right child, or null. */
+    bool red;                   /* True if red, false if black. */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to
+   the structure that RB_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element.  See the big comment at the top of the
+   file for an example. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent             \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rbtree
+  {
+    struct rb_elem *root;       /* Root element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in tree. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rbtree *, rb_less_func *, void *aux);
+
+/* Insertion and removal. */
+void rb_insert (struct rbtree *, struct rb_elem *);
+void rb_remove (struct rbtree *, struct rb_elem *);
+struct rb_elem *rb_pop_first (struct rbtree *);
+
+/* Search. */
+struct rb_elem *rb_find (struct rbtree *, const struct rb_elem *key);
+struct rb_elem *rb_lower_bound (struct rbtree *, const struct rb_elem *key);
+struct rb_elem *rb_upper_bound (struct rbtree *, const struct rb_elem *key);
+
+/* Traversal. */
+struct rb_elem *rb_first (struct rbtree *);
+struct rb_elem *rb_last (struct rbtree *);
+struct rb_elem *rb_next (struct rb_elem *);
+struct rb_elem *rb_prev (struct rb_elem *);
+
+/* Properties. */
+size_t rb_size (const struct rbtree *);
+bool rb_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
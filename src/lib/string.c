@@ -1,5 +1,27 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The bulk operations below work a 32-bit word at a time, using
+   the x86 string instructions where they apply.  These rely on
+   the direction flag being clear, as the calling convention
+   requires and as the interrupt entry code arranges.
+
+   A word may be accessed through a pointer to `word_t' even if
+   it is part of an object of a different type. */
+typedef uint32_t word_t __attribute__ ((may_alias));
+
+/* Requests shorter than this are not worth aligning first. */
+#define ALIGN_MIN 16
+
+/* Returns the number of bytes from P to the next word boundary,
+   but no more than SIZE. */
+static inline size_t
+head_bytes (const void *p, size_t size)
+{
+  size_t head = -(uintptr_t) p & (sizeof (word_t) - 1);
+  return head < size ? head : size;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -8,12 +30,23 @@ memcpy (void *dst_, const void *src_, size_t size)
 {
   unsigned char *dst = dst_;
   const unsigned char *src = src_;
+  size_t cnt;
 
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  /* Copy bytes until DST is aligned, then whole words, then the
+     remaining bytes. */
+  cnt = size >= ALIGN_MIN ? head_bytes (dst, size) : 0;
+  size -= cnt;
+  asm volatile ("rep movsb"
+                : "+D" (dst), "+S" (src), "+c" (cnt) : : "memory");
+  cnt = size / sizeof (word_t);
+  asm volatile ("rep movsl"
+                : "+D" (dst), "+S" (src), "+c" (cnt) : : "memory");
+  cnt = size % sizeof (word_t);
+  asm volatile ("rep movsb"
+                : "+D" (dst), "+S" (src), "+c" (cnt) : : "memory");
 
   return dst_;
 }
@@ -58,6 +91,22 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip over equal words, aligning A first if that is worth
+     it.  B may remain unaligned, which x86 permits. */
+  if (size >= ALIGN_MIN)
+    for (; ((uintptr_t) a & (sizeof (word_t) - 1)) != 0; a++, b++, size--)
+      if (*a != *b)
+        return *a > *b ? +1 : -1;
+  while (size >= sizeof (word_t)
+         && *(const word_t *) a == *(const word_t *) b)
+    {
+      a += sizeof (word_t);
+      b += sizeof (word_t);
+      size -= sizeof (word_t);
+    }
+
+  /* Find the differing byte, if any, in the last word or the
+     remaining bytes. */
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -279,15 +328,32 @@ void *
 memset (void *dst_, int value, size_t size) 
 {
   unsigned char *dst = dst_;
+  word_t word = (unsigned char) value * 0x01010101u;
+  size_t cnt;
 
   ASSERT (dst != NULL || size == 0);
-  
-  while (size-- > 0)
-    *dst++ = value;
+
+  /* Store bytes until DST is aligned, then whole words, then the
+     remaining bytes. */
+  cnt = size >= ALIGN_MIN ? head_bytes (dst, size) : 0;
+  size -= cnt;
+  asm volatile ("rep stosb" : "+D" (dst), "+c" (cnt) : "a" (word) : "memory");
+  cnt = size / sizeof (word_t);
+  asm volatile ("rep stosl" : "+D" (dst), "+c" (cnt) : "a" (word) : "memory");
+  cnt = size % sizeof (word_t);
+  asm volatile ("rep stosb" : "+D" (dst), "+c" (cnt) : "a" (word) : "memory");
 
   return dst_;
 }
 
+/* Returns nonzero if word W contains a null byte, zero
+   otherwise. */
+static inline word_t
+has_null (word_t w)
+{
+  return (w - 0x01010101u) & ~w & 0x80808080u;
+}
+
 /* Returns the length of STRING. */
 size_t
 strlen (const char *string) 
@@ -296,8 +362,16 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
-    continue;
+  /* Check bytes until P is aligned, then whole words.  An aligned
+     word never crosses a page boundary, so reading the bytes
+     past the null terminator in its word is safe. */
+  for (p = string; ((uintptr_t) p & (sizeof (word_t) - 1)) != 0; p++)
+    if (*p == '\0')
+      return p - string;
+  while (!has_null (*(const word_t *) p))
+    p += sizeof (word_t);
+  while (*p != '\0')
+    p++;
   return p - string;
 }
 
@@ -28,7 +28,13 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_VMSTATS,                /* Obtain virtual memory statistics. */
+    SYS_HEAPSTATS,              /* Obtain kernel memory statistics. */
+    SYS_TICKETS,                /* Split off a stride scheduler group. */
+    SYS_REALTIME                /* Reserve real-time CPU time. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -182,3 +182,27 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+vmstats (struct vmstats *process, struct vmstats *system)
+{
+  return syscall2 (SYS_VMSTATS, process, system);
+}
+
+int
+heapstats (struct heapstats *stats, struct heap_tag_stats *tags, int tag_cnt)
+{
+  return syscall3 (SYS_HEAPSTATS, stats, tags, tag_cnt);
+}
+
+bool
+tickets (int tickets)
+{
+  return syscall1 (SYS_TICKETS, tickets);
+}
+
+bool
+realtime (int period, int budget)
+{
+  return syscall2 (SYS_REALTIME, period, budget);
+}
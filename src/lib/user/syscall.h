@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <heapstats.h>
+#include <vmstats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,10 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int vmstats (struct vmstats *process, struct vmstats *system);
+int heapstats (struct heapstats *, struct heap_tag_stats *tags, int tag_cnt);
+bool tickets (int tickets);
+bool realtime (int period, int budget);
+
 #endif /* lib/user/syscall.h */
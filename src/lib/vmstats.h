@@ -0,0 +1,17 @@
+#ifndef __LIB_VMSTATS_H
+#define __LIB_VMSTATS_H
+
+/* Virtual memory statistics, kept for each process and for the
+   system as a whole, and reported by the vmstats system call. */
+struct vmstats
+  {
+    unsigned long long minor_faults;  /* Faults resolved without I/O. */
+    unsigned long long major_faults;  /* Faults that read from disk. */
+    unsigned long long file_faults;   /* Faults on file-backed pages. */
+    unsigned long long anon_faults;   /* Faults on anonymous pages. */
+    unsigned long long bad_faults;    /* Faults on invalid addresses. */
+    unsigned long long fault_cycles;  /* CPU cycles spent in faults. */
+    unsigned working_set;             /* Pages used in last interval. */
+  };
+
+#endif /* lib/vmstats.h */
@@ -0,0 +1,177 @@
+/* Test program for lib/kernel/heap.c.
+
+   Fills heaps with values in random order and checks that they
+   come out in order, including after removing arbitrary elements
+   and changing the values of elements already in the heap.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <heap.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a heap that we will test. */
+#define MAX_SIZE 64
+
+/* A heap element. */
+struct value
+  {
+    struct heap_elem elem;      /* Heap element. */
+    int value;                  /* Item value. */
+  };
+
+static void shuffle (struct value *[], size_t);
+static bool value_less (const struct heap_elem *, const struct heap_elem *,
+                        void *);
+static size_t verify_subheap (struct heap_elem *, struct heap_elem *parent);
+static void verify_heap (struct heap *);
+static void verify_pops (struct heap *, int size);
+
+/* Test the heap implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size heaps:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          struct value *order[MAX_SIZE];
+          struct heap heap;
+          int i;
+
+          /* Put pointers to values 0...SIZE in random order in
+             ORDER. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i;
+              order[i] = &values[i];
+            }
+          shuffle (order, size);
+
+          /* Insert them, then verify that they come out in order. */
+          heap_init (&heap, value_less, NULL);
+          for (i = 0; i < size; i++)
+            {
+              heap_insert (&heap, &order[i]->elem);
+              verify_heap (&heap);
+            }
+          ASSERT (heap_size (&heap) == (size_t) size);
+          verify_pops (&heap, size);
+
+          /* Insert them again, then remove every other one, in
+             random order, and put them back. */
+          for (i = 0; i < size; i++)
+            heap_insert (&heap, &order[i]->elem);
+          shuffle (order, size);
+          for (i = 0; i < size; i += 2)
+            {
+              heap_remove (&heap, &order[i]->elem);
+              verify_heap (&heap);
+            }
+          for (i = 0; i < size; i += 2)
+            heap_insert (&heap, &order[i]->elem);
+          verify_pops (&heap, size);
+
+          /* Insert them again with values reversed, then restore
+             the values one at a time with heap_update(). */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = size - 1 - i;
+              heap_insert (&heap, &values[i].elem);
+            }
+          shuffle (order, size);
+          for (i = 0; i < size; i++)
+            {
+              order[i]->value = order[i] - values;
+              heap_update (&heap, &order[i]->elem);
+              verify_heap (&heap);
+            }
+          verify_pops (&heap, size);
+        }
+    }
+
+  printf (" done\n");
+  printf ("heap: PASS\n");
+}
+
+/* Shuffles the CNT pointers in ARRAY into random order.  The
+   values themselves stay put, since they may be linked into a
+   tree or heap. */
+static void
+shuffle (struct value **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = heap_entry (a_, struct value, elem);
+  const struct value *b = heap_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies that no element in the subheap rooted at E, whose
+   parent should be PARENT, is less than its parent.  Returns the
+   number of elements in the subheap. */
+static size_t
+verify_subheap (struct heap_elem *e, struct heap_elem *parent)
+{
+  if (e == NULL)
+    return 0;
+
+  ASSERT (e->parent == parent);
+  ASSERT (parent == NULL || !value_less (e, parent, NULL));
+  return 1 + verify_subheap (e->left, e) + verify_subheap (e->right, e);
+}
+
+/* Verifies that HEAP is a valid heap with as many elements as it
+   claims. */
+static void
+verify_heap (struct heap *heap)
+{
+  ASSERT (verify_subheap (heap->root, NULL) == heap_size (heap));
+  ASSERT (heap_empty (heap) == (heap_size (heap) == 0));
+}
+
+/* Verifies that popping every element from HEAP yields the
+   values 0...SIZE in order, and leaves HEAP empty. */
+static void
+verify_pops (struct heap *heap, int size)
+{
+  int i;
+
+  for (i = 0; i < size; i++)
+    {
+      struct heap_elem *e = heap_min (heap);
+      ASSERT (heap_pop_min (heap) == e);
+      ASSERT (heap_entry (e, struct value, elem)->value == i);
+      verify_heap (heap);
+    }
+  ASSERT (heap_empty (heap));
+  ASSERT (heap_pop_min (heap) == NULL);
+}
@@ -0,0 +1,221 @@
+/* Test program for lib/kernel/rbtree.c.
+
+   Inserts and removes values in random order, checking after
+   each step that the tree is ordered and balanced and that
+   searching and traversal find the expected elements.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a tree that we will test. */
+#define MAX_SIZE 64
+
+/* A tree element. */
+struct value
+  {
+    struct rb_elem elem;        /* Tree element. */
+    int value;                  /* Item value. */
+  };
+
+static void shuffle (struct value *[], size_t);
+static bool value_less (const struct rb_elem *, const struct rb_elem *,
+                        void *);
+static int verify_subtree (struct rb_elem *, struct rb_elem *parent);
+static void verify_tree (struct rbtree *, const bool present[], int size);
+
+/* Test the red-black tree implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          static struct value dups[MAX_SIZE];
+          struct value *order[MAX_SIZE];
+          bool present[MAX_SIZE];
+          struct rbtree tree;
+          struct rb_elem *e;
+          int i;
+
+          /* Put pointers to values 0...SIZE in random order in
+             ORDER. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i;
+              order[i] = &values[i];
+              present[i] = false;
+            }
+          shuffle (order, size);
+
+          /* Insert them one at a time, verifying each time. */
+          rb_init (&tree, value_less, NULL);
+          for (i = 0; i < size; i++)
+            {
+              rb_insert (&tree, &order[i]->elem);
+              present[order[i]->value] = true;
+              verify_tree (&tree, present, size);
+            }
+
+          /* Insert a duplicate of every value and check that each
+             comes after the original, then remove them again. */
+          for (i = 0; i < size; i++)
+            {
+              dups[i].value = order[i]->value;
+              rb_insert (&tree, &dups[i].elem);
+            }
+          ASSERT (rb_size (&tree) == (size_t) size * 2);
+          for (i = 0; i < size; i++)
+            {
+              e = rb_find (&tree, &order[i]->elem);
+              ASSERT (e == &order[i]->elem);
+              ASSERT (rb_next (e) == &dups[i].elem);
+              ASSERT (rb_upper_bound (&tree, &order[i]->elem)
+                      == rb_next (&dups[i].elem));
+            }
+          for (i = 0; i < size; i++)
+            rb_remove (&tree, &dups[i].elem);
+          verify_tree (&tree, present, size);
+
+          /* Remove the values in a different random order,
+             verifying each time. */
+          shuffle (order, size);
+          for (i = 0; i < size; i++)
+            {
+              rb_remove (&tree, &order[i]->elem);
+              present[order[i]->value] = false;
+              verify_tree (&tree, present, size);
+            }
+          ASSERT (rb_empty (&tree));
+          ASSERT (rb_pop_first (&tree) == NULL);
+        }
+    }
+
+  printf (" done\n");
+  printf ("rbtree: PASS\n");
+}
+
+/* Shuffles the CNT pointers in ARRAY into random order.  The
+   values themselves stay put, since they may be linked into a
+   tree or heap. */
+static void
+shuffle (struct value **array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct rb_elem *a_, const struct rb_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = rb_entry (a_, struct value, elem);
+  const struct value *b = rb_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies that the subtree rooted at E, whose parent should be
+   PARENT, follows the red-black rules.  Returns its black
+   height. */
+static int
+verify_subtree (struct rb_elem *e, struct rb_elem *parent)
+{
+  int left_height, right_height;
+
+  if (e == NULL)
+    return 1;
+
+  ASSERT (e->parent == parent);
+  if (e->red)
+    {
+      ASSERT ((e->left == NULL || !e->left->red)
+              && (e->right == NULL || !e->right->red));
+    }
+  left_height = verify_subtree (e->left, e);
+  right_height = verify_subtree (e->right, e);
+  ASSERT (left_height == right_height);
+  return left_height + !e->red;
+}
+
+/* Verifies that TREE is a valid red-black tree that contains
+   exactly the values V for which PRESENT[V] is true, among 0...SIZE,
+   and that searching and traversal in both directions work. */
+static void
+verify_tree (struct rbtree *tree, const bool present[], int size)
+{
+  struct rb_elem *e;
+  size_t cnt = 0;
+  int i;
+
+  ASSERT (tree->root == NULL || !tree->root->red);
+  verify_subtree (tree->root, NULL);
+
+  /* Forward traversal visits the present values in order. */
+  for (i = 0, e = rb_first (tree); i < size; i++)
+    if (present[i])
+      {
+        ASSERT (e != NULL);
+        ASSERT (rb_entry (e, struct value, elem)->value == i);
+        e = rb_next (e);
+        cnt++;
+      }
+  ASSERT (e == NULL);
+  ASSERT (rb_size (tree) == cnt);
+  ASSERT (rb_empty (tree) == (cnt == 0));
+
+  /* So does backward traversal, in reverse. */
+  for (i = size - 1, e = rb_last (tree); i >= 0; i--)
+    if (present[i])
+      {
+        ASSERT (e != NULL);
+        ASSERT (rb_entry (e, struct value, elem)->value == i);
+        e = rb_prev (e);
+      }
+  ASSERT (e == NULL);
+
+  /* Searching finds each present value, and the lower bound of
+     each absent value is the next present value, if any. */
+  for (i = 0; i < size; i++)
+    {
+      struct value key;
+      int next;
+
+      key.value = i;
+      e = rb_find (tree, &key.elem);
+      ASSERT (present[i]
+              ? e != NULL && rb_entry (e, struct value, elem)->value == i
+              : e == NULL);
+
+      for (next = i; next < size && !present[next]; next++)
+        continue;
+      e = rb_lower_bound (tree, &key.elem);
+      ASSERT (next < size
+              ? e != NULL && rb_entry (e, struct value, elem)->value == next
+              : e == NULL);
+    }
+}
@@ -0,0 +1,195 @@
+/* Test program and benchmark for memcpy(), memset(), memcmp(),
+   and strlen() in lib/string.c.
+
+   Checks each function against a simple byte-at-a-time version
+   for every combination of source and destination alignment
+   and many sizes, then reports how many CPU cycles each takes,
+   next to the byte-at-a-time version, for a few buffer sizes.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Largest buffer tested or timed, in bytes. */
+#define MAX_SIZE 4096
+
+/* Number of times each benchmark is repeated. */
+#define REPEAT 64
+
+/* Buffers, with room for misalignment and guard bytes. */
+static unsigned char src[MAX_SIZE + 16];
+static unsigned char dst[MAX_SIZE + 16];
+static unsigned char ref[MAX_SIZE + 16];
+
+static void check_functions (void);
+static void benchmark (size_t size);
+
+/* Tests and times the string functions. */
+void
+test (void)
+{
+  size_t size;
+
+  check_functions ();
+  printf ("string functions ok\n");
+
+  for (size = 16; size <= MAX_SIZE; size *= 4)
+    benchmark (size);
+  printf ("done\n");
+}
+
+/* Byte-at-a-time versions, for checking and for comparison. */
+
+static void
+byte_memcpy (void *dst_, const void *src_, size_t size)
+{
+  unsigned char *d = dst_;
+  const unsigned char *s = src_;
+
+  while (size-- > 0)
+    *d++ = *s++;
+}
+
+static void
+byte_memset (void *dst_, int value, size_t size)
+{
+  unsigned char *d = dst_;
+
+  while (size-- > 0)
+    *d++ = value;
+}
+
+static int
+byte_memcmp (const void *a_, const void *b_, size_t size)
+{
+  const unsigned char *a = a_;
+  const unsigned char *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static size_t
+byte_strlen (const char *string)
+{
+  const char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
+
+/* Returns -1, 0, or +1 according to the sign of X. */
+static int
+sign (int x)
+{
+  return (x > 0) - (x < 0);
+}
+
+/* Fills BUF with SIZE random bytes. */
+static void
+randomize (unsigned char *buf, size_t size)
+{
+  random_bytes (buf, size);
+}
+
+/* Checks each function against its byte-at-a-time version, for
+   all alignments of source and destination and sizes from 0 to
+   somewhat more than a few words, plus a few larger sizes. */
+static void
+check_functions (void)
+{
+  static const size_t big_sizes[] = {255, 256, 257, 1000, MAX_SIZE - 8};
+  size_t s_ofs, d_ofs, size, i;
+
+  for (s_ofs = 0; s_ofs < 8; s_ofs++)
+    for (d_ofs = 0; d_ofs < 8; d_ofs++)
+      for (size = 0; size < 64 + sizeof big_sizes / sizeof *big_sizes;
+           size++)
+        {
+          size_t n = size < 64 ? size : big_sizes[size - 64];
+          unsigned char *s = src + s_ofs;
+          unsigned char *d = dst + d_ofs;
+
+          /* memcpy(), including guard bytes on both ends. */
+          randomize (src, sizeof src);
+          randomize (dst, sizeof dst);
+          memcpy (ref, dst, sizeof ref);
+          memcpy (d, s, n);
+          byte_memcpy (ref + d_ofs, s, n);
+          ASSERT (byte_memcmp (dst, ref, sizeof dst) == 0);
+
+          /* memset(). */
+          memset (d, s_ofs * 37, n);
+          byte_memset (ref + d_ofs, s_ofs * 37, n);
+          ASSERT (byte_memcmp (dst, ref, sizeof dst) == 0);
+
+          /* memcmp(), with equal buffers and with a difference at
+             each end and in the middle. */
+          byte_memcpy (d, s, n);
+          ASSERT (memcmp (d, s, n) == 0);
+          for (i = 0; i < 3 && n > 0; i++)
+            {
+              size_t pos = i == 0 ? 0 : i == 1 ? n / 2 : n - 1;
+              d[pos]++;
+              ASSERT (sign (memcmp (d, s, n))
+                      == sign (byte_memcmp (d, s, n)));
+              ASSERT (sign (memcmp (s, d, n))
+                      == sign (byte_memcmp (s, d, n)));
+              d[pos]--;
+            }
+
+          /* strlen(). */
+          byte_memset (s, 'x', n);
+          s[n] = '\0';
+          ASSERT (strlen ((char *) s) == n);
+          ASSERT (byte_strlen ((char *) s) == n);
+        }
+}
+
+/* Prints the average number of cycles taken by EXPR, which
+   operates on a buffer of SIZE bytes, labeled NAME. */
+#define TIME(NAME, SIZE, EXPR)                                          \
+        do                                                              \
+          {                                                             \
+            uint64_t start = timer_cycles ();                           \
+            int i;                                                      \
+            for (i = 0; i < REPEAT; i++)                                \
+              EXPR;                                                     \
+            printf ("%-12s %5zu bytes: %8"PRIu64" cycles\n",            \
+                    NAME, SIZE, (timer_cycles () - start) / REPEAT);    \
+          }                                                             \
+        while (0)
+
+/* Times each function and its byte-at-a-time version on
+   buffers of SIZE bytes. */
+static void
+benchmark (size_t size)
+{
+  volatile size_t result;
+
+  byte_memset (src, 'x', size);
+  src[size - 1] = '\0';
+  byte_memcpy (dst, src, size);
+
+  TIME ("memcpy", size, memcpy (dst, src, size));
+  TIME ("byte memcpy", size, byte_memcpy (dst, src, size));
+  TIME ("memset", size, memset (ref, 0, size));
+  TIME ("byte memset", size, byte_memset (ref, 0, size));
+  TIME ("memcmp", size, result = memcmp (dst, src, size));
+  TIME ("byte memcmp", size, result = byte_memcmp (dst, src, size));
+  TIME ("strlen", size, result = strlen ((char *) src));
+  TIME ("byte strlen", size, result = byte_strlen ((char *) src));
+  (void) result;
+}
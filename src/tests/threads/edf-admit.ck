@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admit) begin
+(edf-admit) Invalid reservations are refused.
+(edf-admit) Main thread reserves 5 of every 10 ticks.
+(edf-admit) Another thread can reserve 4 more ticks but not 5.
+(edf-admit) Main thread leaves the class, then reserves 9 of 10 ticks.
+(edf-admit) end
+EOF
+pass;
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-throttle) begin
+(edf-throttle) Starting a PRI_MAX thread and a real-time PRI_MIN thread.
+(edf-throttle) Real-time thread received about 2 ticks per period.
+(edf-throttle) end
+EOF
+pass;
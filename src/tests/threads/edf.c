@@ -0,0 +1,130 @@
+/* Tests the earliest-deadline-first real-time class.
+
+   The edf-admit test checks admission control: reservations are
+   granted only while the reserved shares of all threads add up to
+   no more than RT_UTIL_MAX, and are released when a thread leaves
+   the class or exits.
+
+   The edf-throttle test runs a real-time thread at PRI_MIN that
+   reserves 2 of every 10 ticks against a thread at PRI_MAX, both
+   spinning for 100 ticks.  Without its reservation the PRI_MIN
+   thread would never run, and without budget enforcement it would
+   keep the CPU to itself, so it should receive about 20 ticks and
+   the PRI_MAX thread about 80. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void check_realtime (int period, int budget, bool expected);
+static void admit_thread (void *aux);
+
+void
+test_edf_admit (void) 
+{
+  struct semaphore done;
+
+  msg ("Invalid reservations are refused.");
+  check_realtime (10, 11, false);
+  check_realtime (10, 0, false);
+  check_realtime (-10, 5, false);
+
+  msg ("Main thread reserves 5 of every 10 ticks.");
+  check_realtime (10, 5, true);
+
+  msg ("Another thread can reserve 4 more ticks but not 5.");
+  sema_init (&done, 0);
+  thread_create ("admit", PRI_DEFAULT, admit_thread, &done);
+  sema_down (&done);
+
+  msg ("Main thread leaves the class, then reserves 9 of 10 ticks.");
+  check_realtime (0, 0, true);
+  check_realtime (10, 9, true);
+  check_realtime (10, 10, false);
+  check_realtime (0, 0, true);
+}
+
+/* Calls thread_set_realtime (PERIOD, BUDGET) and fails the test
+   unless it returns EXPECTED. */
+static void
+check_realtime (int period, int budget, bool expected) 
+{
+  if (thread_set_realtime (period, budget) != expected)
+    fail ("thread_set_realtime (%d, %d) should have %s", period, budget,
+          expected ? "succeeded" : "failed");
+}
+
+/* Tries to reserve 5, then 4, of every 10 ticks while the main
+   thread holds 5, then exits, releasing its reservation. */
+static void
+admit_thread (void *done_) 
+{
+  struct semaphore *done = done_;
+
+  check_realtime (10, 5, false);
+  check_realtime (10, 4, true);
+  sema_up (done);
+}
+
+/* A spinning thread. */
+struct spin_info 
+  {
+    int64_t start_time;         /* Time the test started. */
+    int period, budget;         /* Real-time reservation, if nonzero. */
+    int tick_count;             /* Ticks received. */
+  };
+
+static void spin_thread (void *aux);
+
+void
+test_edf_throttle (void) 
+{
+  struct spin_info rt, high;
+  int64_t start_time = timer_ticks ();
+
+  rt.start_time = high.start_time = start_time;
+  rt.period = 10;
+  rt.budget = 2;
+  high.period = high.budget = 0;
+  rt.tick_count = high.tick_count = 0;
+
+  msg ("Starting a PRI_MAX thread and a real-time PRI_MIN thread.");
+  thread_create ("high", PRI_MAX, spin_thread, &high);
+  thread_create ("rt", PRI_MIN, spin_thread, &rt);
+
+  timer_sleep (200 - timer_elapsed (start_time));
+
+  if (rt.tick_count < 15 || rt.tick_count > 25)
+    fail ("real-time thread received %d ticks, expected about 20",
+          rt.tick_count);
+  if (high.tick_count < 70)
+    fail ("PRI_MAX thread received %d ticks, expected about 80",
+          high.tick_count);
+  msg ("Real-time thread received about 2 ticks per period.");
+}
+
+/* Reserves real-time CPU time if requested, then spins from 50 to
+   150 ticks after the start of the test, counting the ticks it
+   receives. */
+static void
+spin_thread (void *si_) 
+{
+  struct spin_info *si = si_;
+  int64_t last_time = 0;
+
+  if (si->period != 0 && !thread_set_realtime (si->period, si->budget))
+    fail ("thread_set_realtime (%d, %d) failed", si->period, si->budget);
+
+  timer_sleep (50 - timer_elapsed (si->start_time));
+  while (timer_elapsed (si->start_time) < 150) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        si->tick_count++;
+      last_time = cur_time;
+    }
+}
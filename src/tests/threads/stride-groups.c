@@ -0,0 +1,105 @@
+/* Checks that the stride scheduler divides the CPU among ticket
+   groups in proportion to their tickets, however many threads
+   each group runs.
+
+   Group A has 200 tickets and one thread.  Group B has 100
+   tickets and three threads.  All four threads spin for 10
+   seconds, over which A's thread should receive about twice as
+   many ticks as B's three threads together. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* A ticket group. */
+struct group_info 
+  {
+    int tickets;                /* Tickets for the group. */
+    int thread_cnt;             /* Number of threads in the group. */
+    int64_t start_time;         /* Time the test started. */
+    int tick_count;             /* Ticks received by the group. */
+    struct lock lock;           /* Protects tick_count. */
+  };
+
+static void group_thread (void *aux);
+static void load_thread (void *aux);
+
+void
+test_stride_groups (void) 
+{
+  struct group_info a, b;
+  int64_t start_time;
+  int total, ratio;
+
+  ASSERT (thread_stride);
+
+  start_time = timer_ticks ();
+  a.tickets = 200;
+  a.thread_cnt = 1;
+  b.tickets = 100;
+  b.thread_cnt = 3;
+  a.start_time = b.start_time = start_time;
+  a.tick_count = b.tick_count = 0;
+  lock_init (&a.lock);
+  lock_init (&b.lock);
+
+  msg ("Starting group A with 200 tickets and 1 thread.");
+  thread_create ("group a", PRI_DEFAULT, group_thread, &a);
+  msg ("Starting group B with 100 tickets and 3 threads.");
+  thread_create ("group b", PRI_DEFAULT, group_thread, &b);
+
+  msg ("Sleeping 12 seconds to let threads run, please wait...");
+  timer_sleep (12 * TIMER_FREQ - timer_elapsed (start_time));
+
+  total = a.tick_count + b.tick_count;
+  if (total < 9 * TIMER_FREQ)
+    fail ("groups received only %d ticks in all", total);
+  ratio = a.tick_count * 100 / (b.tick_count > 0 ? b.tick_count : 1);
+  if (ratio < 170 || ratio > 230)
+    fail ("group A received %d ticks and group B %d, expected about 2:1",
+          a.tick_count, b.tick_count);
+  msg ("Group A received about twice as many ticks as group B.");
+}
+
+/* Moves into a new ticket group for the group in GI_, then
+   starts the group's threads. */
+static void
+group_thread (void *gi_) 
+{
+  struct group_info *gi = gi_;
+  int i;
+
+  if (!thread_set_tickets (gi->tickets))
+    fail ("thread_set_tickets (%d) failed", gi->tickets);
+  for (i = 0; i < gi->thread_cnt; i++)
+    thread_create ("load", PRI_DEFAULT, load_thread, gi);
+}
+
+/* Spins from 1 to 11 seconds after the start of the test,
+   counting the ticks it receives for its group. */
+static void
+load_thread (void *gi_) 
+{
+  struct group_info *gi = gi_;
+  int64_t sleep_time = 1 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 10 * TIMER_FREQ;
+  int64_t last_time = 0;
+  int tick_count = 0;
+
+  timer_sleep (sleep_time - timer_elapsed (gi->start_time));
+  while (timer_elapsed (gi->start_time) < spin_time) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        tick_count++;
+      last_time = cur_time;
+    }
+
+  lock_acquire (&gi->lock);
+  gi->tick_count += tick_count;
+  lock_release (&gi->lock);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stride-groups) begin
+(stride-groups) Starting group A with 200 tickets and 1 thread.
+(stride-groups) Starting group B with 100 tickets and 3 threads.
+(stride-groups) Sleeping 12 seconds to let threads run, please wait...
+(stride-groups) Group A received about twice as many ticks as group B.
+(stride-groups) end
+EOF
+pass;
@@ -38,6 +38,9 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"stride-groups", test_stride_groups},
+    {"edf-admit", test_edf_admit},
+    {"edf-throttle", test_edf_throttle},
   };
 
 static const char *test_name;
@@ -32,6 +32,9 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_stride_groups;
+extern test_func test_edf_admit;
+extern test_func test_edf_throttle;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,67 @@
+/* Child process run by fpu-interleave test.
+
+   Loads a value derived from its argument into the x87 stack
+   and into SSE register xmm0, spins long enough to be preempted
+   several times, and then checks that both registers still hold
+   the same value.  Repeats this for several rounds, and returns
+   its argument if every check passed. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-fpu";
+
+#define ROUNDS 16
+#define SPIN_CNT 2000000
+
+/* Loads X87 as an integer onto the empty x87 stack and XMM into
+   xmm0. */
+static void
+fpu_load (int x87, const unsigned char xmm[16])
+{
+  asm volatile ("fninit; fildl %0; movdqu %1, %%xmm0"
+                : : "m" (x87), "m" (*(const unsigned char (*)[16]) xmm));
+}
+
+/* Stores the top of the x87 stack, as an integer, into *X87,
+   and xmm0 into XMM. */
+static void
+fpu_store (int *x87, unsigned char xmm[16])
+{
+  asm volatile ("fistl %0; movdqu %%xmm0, %1"
+                : "=m" (*x87), "=m" (*(unsigned char (*)[16]) xmm));
+}
+
+int
+main (int argc, char *argv[])
+{
+  int child;
+  int round;
+
+  if (argc != 2)
+    fail ("argc must be 2, actually %d", argc);
+  child = atoi (argv[1]);
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      unsigned char xmm[16], got_xmm[16];
+      int x87 = (child + 1) * 1000 + round;
+      int got_x87;
+      volatile int i;
+
+      memset (xmm, 0x11 * (child + 1) + round, sizeof xmm);
+      fpu_load (x87, xmm);
+      for (i = 0; i < SPIN_CNT; i++)
+        continue;
+      fpu_store (&got_x87, got_xmm);
+
+      if (got_x87 != x87)
+        fail ("round %d: x87 held %d, expected %d", round, got_x87, x87);
+      if (memcmp (got_xmm, xmm, sizeof xmm))
+        fail ("round %d: xmm0 changed", round);
+    }
+
+  return child;
+}
@@ -0,0 +1,18 @@
+/* Runs two child processes at once, each of which keeps its own
+   values in the x87 and SSE registers while the other runs, and
+   verifies that neither one sees the other's register state. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 2
+
+void
+test_main (void)
+{
+  pid_t pids[CHILD_CNT];
+
+  exec_children ("child-fpu", pids, CHILD_CNT);
+  wait_children (pids, CHILD_CNT);
+}
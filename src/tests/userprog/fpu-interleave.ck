@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(fpu-interleave) begin
+(fpu-interleave) exec child 1 of 2: "child-fpu 0"
+(fpu-interleave) exec child 2 of 2: "child-fpu 1"
+child-fpu: exit(0)
+child-fpu: exit(1)
+(fpu-interleave) wait for child 1 of 2 returned 0 (expected 0)
+(fpu-interleave) wait for child 2 of 2 returned 1 (expected 1)
+(fpu-interleave) end
+fpu-interleave: exit(0)
+EOF
+(fpu-interleave) begin
+(fpu-interleave) exec child 1 of 2: "child-fpu 0"
+(fpu-interleave) exec child 2 of 2: "child-fpu 1"
+child-fpu: exit(1)
+child-fpu: exit(0)
+(fpu-interleave) wait for child 1 of 2 returned 0 (expected 0)
+(fpu-interleave) wait for child 2 of 2 returned 1 (expected 1)
+(fpu-interleave) end
+fpu-interleave: exit(0)
+EOF
+pass;
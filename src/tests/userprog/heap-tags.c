@@ -0,0 +1,81 @@
+/* Creates and opens FILE_CNT files and verifies that the
+   heapstats system call reports FILE_CNT more objects under the
+   "file" and "inode" tags.  Also checks that a tag count of 0 or
+   a null tag array returns the number of tags without copying
+   any of them. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 5
+#define TAG_CNT 16
+
+/* Returns the number of objects that TAGS, an array of CNT tags,
+   reports under NAME.  Fails if NAME is not among them. */
+static unsigned
+tag_blocks (const struct heap_tag_stats tags[], int cnt, const char *name)
+{
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    if (!strcmp (tags[i].name, name))
+      return tags[i].blocks;
+  fail ("no \"%s\" tag", name);
+}
+
+/* Stores up to TAG_CNT tags into TAGS and returns the number
+   stored. */
+static int
+get_tags (struct heap_tag_stats tags[TAG_CNT])
+{
+  int cnt = heapstats (NULL, tags, TAG_CNT);
+  return cnt < TAG_CNT ? cnt : TAG_CNT;
+}
+
+void
+test_main (void)
+{
+  struct heap_tag_stats before[TAG_CNT], after[TAG_CNT], unused[TAG_CNT];
+  int before_cnt, after_cnt, total;
+  int handles[FILE_CNT];
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "file%d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+    }
+
+  memset (unused, 0x5a, sizeof unused);
+  total = heapstats (NULL, unused, 0);
+  CHECK (total > 0, "heapstats with 0 tags returns count");
+  CHECK (heapstats (NULL, NULL, TAG_CNT) == total,
+         "heapstats with null tags returns same count");
+  for (i = 0; i < (int) sizeof unused; i++)
+    if (((unsigned char *) unused)[i] != 0x5a)
+      fail ("heapstats with 0 tags modified byte %d of tag array", i);
+
+  before_cnt = get_tags (before);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "file%d", i);
+      CHECK ((handles[i] = open (name)) > 1, "open \"%s\"", name);
+    }
+  after_cnt = get_tags (after);
+
+  if (tag_blocks (after, after_cnt, "file")
+      != tag_blocks (before, before_cnt, "file") + FILE_CNT)
+    fail ("\"file\" tag did not rise by %d", FILE_CNT);
+  if (tag_blocks (after, after_cnt, "inode")
+      != tag_blocks (before, before_cnt, "inode") + FILE_CNT)
+    fail ("\"inode\" tag did not rise by %d", FILE_CNT);
+  msg ("\"file\" and \"inode\" tags rose by %d", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i++)
+    close (handles[i]);
+}
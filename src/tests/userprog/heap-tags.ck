@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(heap-tags) begin
+(heap-tags) create "file0"
+(heap-tags) create "file1"
+(heap-tags) create "file2"
+(heap-tags) create "file3"
+(heap-tags) create "file4"
+(heap-tags) heapstats with 0 tags returns count
+(heap-tags) heapstats with null tags returns same count
+(heap-tags) open "file0"
+(heap-tags) open "file1"
+(heap-tags) open "file2"
+(heap-tags) open "file3"
+(heap-tags) open "file4"
+(heap-tags) "file" and "inode" tags rose by 5
+(heap-tags) end
+heap-tags: exit(0)
+EOF
+pass;
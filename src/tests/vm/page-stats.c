@@ -0,0 +1,44 @@
+/* Touches PAGE_CNT pages that the process has never used before
+   and verifies that the vmstats system call reports at least
+   that many more page faults, for the process and for the system.
+   Also checks that null output pointers are accepted. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 64
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+/* Returns the number of page faults that S records as handled. */
+static unsigned long long
+fault_cnt (const struct vmstats *s)
+{
+  return s->minor_faults + s->major_faults;
+}
+
+void
+test_main (void)
+{
+  struct vmstats before, after, sys_before, sys_after;
+  size_t i;
+
+  CHECK (vmstats (NULL, NULL) == 0, "vmstats with null pointers");
+  CHECK (vmstats (NULL, &sys_before) == 0, "vmstats with null process");
+  CHECK (vmstats (&before, NULL) == 0, "vmstats with null system");
+
+  msg ("touch %d pages", PAGE_CNT);
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i;
+
+  CHECK (vmstats (&after, &sys_after) == 0, "vmstats");
+  if (fault_cnt (&after) < fault_cnt (&before) + PAGE_CNT)
+    fail ("process faults rose by %llu, expected at least %d",
+          fault_cnt (&after) - fault_cnt (&before), PAGE_CNT);
+  if (fault_cnt (&sys_after) < fault_cnt (&sys_before) + PAGE_CNT)
+    fail ("system faults rose by %llu, expected at least %d",
+          fault_cnt (&sys_after) - fault_cnt (&sys_before), PAGE_CNT);
+  msg ("fault counts rose by at least %d", PAGE_CNT);
+}
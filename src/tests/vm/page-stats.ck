@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-stats) begin
+(page-stats) vmstats with null pointers
+(page-stats) vmstats with null process
+(page-stats) vmstats with null system
+(page-stats) touch 64 pages
+(page-stats) vmstats
+(page-stats) fault counts rose by at least 64
+(page-stats) end
+EOF
+pass;
@@ -0,0 +1,106 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <debug.h>
+#include <stdint.h>
+
+/* Fixed-point real arithmetic, for the multi-level feedback
+   queue scheduler, since the kernel does not use floating point.
+
+   A fixed-point number is an int whose low FIX_SHIFT bits are
+   the fraction, so that with 32-bit ints it represents values
+   between about -131,072 and 131,072 to within 1/16,384.  It is
+   wrapped in a struct so that the compiler catches accidental
+   mixing of fixed-point numbers and plain integers. */
+#define FIX_SHIFT 14
+
+/* A fixed-point number. */
+typedef struct
+  {
+    int f;
+  }
+fixed_point_t;
+
+/* Returns a fixed-point number with F as its internal value. */
+static inline fixed_point_t
+__mk_fix (int f)
+{
+  fixed_point_t x;
+  x.f = f;
+  return x;
+}
+
+/* Returns fixed-point number corresponding to integer N. */
+static inline fixed_point_t
+fix_int (int n)
+{
+  return __mk_fix (n << FIX_SHIFT);
+}
+
+/* Returns fixed-point number corresponding to N divided by D. */
+static inline fixed_point_t
+fix_frac (int n, int d)
+{
+  return __mk_fix (((int64_t) n << FIX_SHIFT) / d);
+}
+
+/* Returns X rounded to the nearest integer. */
+static inline int
+fix_round (fixed_point_t x)
+{
+  int half = 1 << (FIX_SHIFT - 1);
+  return (x.f >= 0 ? x.f + half : x.f - half) / (1 << FIX_SHIFT);
+}
+
+/* Returns X truncated toward zero. */
+static inline int
+fix_trunc (fixed_point_t x)
+{
+  return x.f / (1 << FIX_SHIFT);
+}
+
+/* Returns X + Y. */
+static inline fixed_point_t
+fix_add (fixed_point_t x, fixed_point_t y)
+{
+  return __mk_fix (x.f + y.f);
+}
+
+/* Returns X - Y. */
+static inline fixed_point_t
+fix_sub (fixed_point_t x, fixed_point_t y)
+{
+  return __mk_fix (x.f - y.f);
+}
+
+/* Returns X * N. */
+static inline fixed_point_t
+fix_scale (fixed_point_t x, int n)
+{
+  return __mk_fix (x.f * n);
+}
+
+/* Returns X / N. */
+static inline fixed_point_t
+fix_unscale (fixed_point_t x, int n)
+{
+  ASSERT (n != 0);
+  return __mk_fix (x.f / n);
+}
+
+/* Returns X * Y. */
+static inline fixed_point_t
+fix_mul (fixed_point_t x, fixed_point_t y)
+{
+  return __mk_fix ((int64_t) x.f * y.f >> FIX_SHIFT);
+}
+
+/* Returns X / Y. */
+static inline fixed_point_t
+fix_div (fixed_point_t x, fixed_point_t y)
+{
+  ASSERT (y.f != 0);
+  return __mk_fix (((int64_t) x.f << FIX_SHIFT) / y.f);
+}
+
+#endif /* threads/fixed-point.h */
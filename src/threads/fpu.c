@@ -0,0 +1,221 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+
+/* Lazy FPU context switching.
+
+   The kernel itself never uses the x87 FPU or SSE (it is built
+   with -msoft-float), but user programs may.  Saving and
+   restoring their 512-byte FXSAVE state on every context switch
+   would tax every thread, so instead the state stays in the FPU
+   until some other thread needs it.
+
+   The CPU's "task switched" flag, CR0.TS, makes the next FPU or
+   SSE instruction raise #NM, Device Not Available.  We set it at
+   each context switch unless the incoming thread is the one whose
+   state the FPU holds, its owner.  The #NM handler then saves the
+   owner's state, loads the running thread's, and makes it the
+   owner.  A thread that never touches the FPU takes no traps and
+   never gets a save area, and one that runs alone keeps its state
+   in the FPU across any number of switches.
+
+   Save areas are allocated on a thread's first FPU instruction.
+   FXSAVE requires 16-byte alignment, which object cache slots do
+   not guarantee, so each slot has room to align the area within
+   it. */
+
+/* CR0 bits. */
+#define CR0_MP 0x00000002       /* Monitor coprocessor. */
+#define CR0_EM 0x00000004       /* (Floating-point) emulation. */
+#define CR0_TS 0x00000008       /* Task switched. */
+#define CR0_NE 0x00000020       /* Native FPU error reporting. */
+
+/* CR4 bits. */
+#define CR4_OSFXSR 0x00000200   /* FXSAVE, FXRSTOR, and SSE enabled. */
+#define CR4_OSXMMEXCPT 0x00000400 /* SIMD exceptions raise #XF. */
+
+/* CPUID leaf 1 EDX bits. */
+#define CPUID_FXSR 0x01000000   /* FXSAVE and FXRSTOR. */
+#define CPUID_SSE 0x02000000    /* SSE. */
+
+#define FXSAVE_SIZE 512         /* Size of FXSAVE area. */
+#define FXSAVE_ALIGN 16         /* Required alignment of FXSAVE area. */
+#define FCW_DEFAULT 0x037f      /* x87 control word after FNINIT. */
+#define MXCSR_DEFAULT 0x1f80    /* MXCSR at reset: all exceptions masked. */
+
+/* Cache of FXSAVE areas, or a null pointer if the CPU cannot
+   support user floating point, in which case CR0.EM stays set
+   and FPU instructions trap as before. */
+static struct kmem_cache *fpu_cache;
+static bool has_sse;            /* Whether the CPU has SSE and MXCSR. */
+static struct thread *fpu_owner; /* Thread whose state the FPU holds. */
+
+static void fpu_trap (struct intr_frame *);
+
+static inline uint32_t
+read_cr0 (void) 
+{
+  uint32_t cr0;
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  return cr0;
+}
+
+static inline void
+write_cr0 (uint32_t cr0) 
+{
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0));
+}
+
+/* Returns thread T's FXSAVE area, aligned as FXSAVE requires. */
+static void *
+save_area (struct thread *t) 
+{
+  return (void *) ROUND_UP ((uintptr_t) t->fpu, FXSAVE_ALIGN);
+}
+
+/* Enables the FPU and SSE for user programs, if the CPU supports
+   FXSAVE, and installs the #NM handler that switches FPU state
+   lazily.  Must be called after slab_init() and intr_init(). */
+void
+fpu_init (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+  uint32_t cr4;
+
+  asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                : "a" (1));
+  if (!(edx & CPUID_FXSR))
+    return;
+
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  cr4 |= CR4_OSFXSR;
+  has_sse = (edx & CPUID_SSE) != 0;
+  if (has_sse)
+    cr4 |= CR4_OSXMMEXCPT;
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+
+  /* No thread owns the FPU yet, so the first FPU instruction
+     should trap. */
+  write_cr0 ((read_cr0 () & ~CR0_EM) | CR0_MP | CR0_NE | CR0_TS);
+
+  fpu_cache = kmem_cache_create ("fpu", FXSAVE_SIZE + FXSAVE_ALIGN - 1,
+                                 NULL);
+  intr_register_int (7, 0, INTR_OFF, fpu_trap,
+                     "#NM Device Not Available Exception");
+}
+
+/* Returns true if user programs may use the FPU, false if FPU
+   instructions trap. */
+bool
+fpu_available (void) 
+{
+  return fpu_cache != NULL;
+}
+
+/* Called at each switch to thread NEXT, with interrupts off.
+   Leaves the FPU usable if NEXT owns it, and otherwise arranges
+   for NEXT's first FPU instruction to trap. */
+void
+fpu_switch (struct thread *next) 
+{
+  uint32_t cr0, new_cr0;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (fpu_cache == NULL)
+    return;
+
+  cr0 = read_cr0 ();
+  if (fpu_owner == next)
+    new_cr0 = cr0 & ~CR0_TS;
+  else
+    new_cr0 = cr0 | CR0_TS;
+  if (new_cr0 != cr0)
+    write_cr0 (new_cr0);
+}
+
+/* Gives up the running thread's FPU state, if any, before it
+   exits. */
+void
+fpu_exit (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  if (cur->fpu == NULL)
+    return;
+
+  old_level = intr_disable ();
+  if (fpu_owner == cur)
+    {
+      fpu_owner = NULL;
+      write_cr0 (read_cr0 () | CR0_TS);
+    }
+  intr_set_level (old_level);
+
+  kmem_cache_free (fpu_cache, cur->fpu);
+  cur->fpu = NULL;
+}
+
+/* Initializes AREA as the FXSAVE image of a freshly reset FPU,
+   with all registers zero, so that nothing of another thread's
+   state shows through. */
+static void
+init_save_area (uint8_t *area) 
+{
+  uint16_t fcw = FCW_DEFAULT;
+  uint32_t mxcsr = MXCSR_DEFAULT;
+
+  memset (area, 0, FXSAVE_SIZE);
+  memcpy (area, &fcw, sizeof fcw);
+  if (has_sse)
+    memcpy (area + 24, &mxcsr, sizeof mxcsr);
+}
+
+/* #NM handler: the running thread used the FPU while it did not
+   own it.  Saves the owner's state, if any, and loads the running
+   thread's, starting it from a clean state on first use. */
+static void
+fpu_trap (struct intr_frame *f) 
+{
+  struct thread *cur = thread_current ();
+
+  if (f->cs == SEL_KCSEG)
+    {
+      intr_dump_frame (f);
+      PANIC ("Kernel bug - FPU used in kernel");
+    }
+
+  if (cur->fpu == NULL)
+    {
+      /* Allocating may sleep, so do it with interrupts on.  We
+         have no state in the FPU yet, so a switch here loses
+         nothing. */
+      intr_enable ();
+      cur->fpu = kmem_cache_alloc (fpu_cache);
+      if (cur->fpu == NULL)
+        {
+          printf ("%s: out of memory for FPU state\n", thread_name ());
+          thread_exit ();
+        }
+      init_save_area (save_area (cur));
+      intr_disable ();
+    }
+
+  asm volatile ("clts");
+  if (fpu_owner == cur)
+    return;
+  if (fpu_owner != NULL)
+    asm volatile ("fxsave %0" : "=m" (*(char (*)[FXSAVE_SIZE])
+                                      save_area (fpu_owner)));
+  asm volatile ("fxrstor %0" : : "m" (*(char (*)[FXSAVE_SIZE])
+                                      save_area (cur)));
+  fpu_owner = cur;
+}
@@ -15,12 +15,14 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -37,6 +39,13 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -57,8 +66,16 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* Paging feature bits in CR4 and in CPUID leaf 1's EDX. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions. */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+#define CPUID_PSE 0x00000008    /* 4 MB pages supported. */
+#define CPUID_PGE 0x00002000    /* Global pages supported. */
+
 static void bss_init (void);
 static void paging_init (void);
+static uint32_t cpuid_features (void);
+static void set_cr4 (uint32_t bits);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -97,7 +114,12 @@ main (void)
   /* Initialize memory system. */
   palloc_init (user_page_limit);
   malloc_init ();
+  slab_init ();
   paging_init ();
+#ifdef VM
+  frame_init ();
+  share_init ();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -110,9 +132,11 @@ main (void)
   timer_init ();
   kbd_init ();
   input_init ();
+  fpu_init ();
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
@@ -127,6 +151,12 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize virtual memory system. */
+  swap_init ();
+  zswap_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -153,13 +183,27 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports them, each 4 MB of memory that is wholly
+   present and does not contain kernel text, which must stay
+   read-only, is mapped with a single large page.  That takes one
+   TLB entry instead of 1,024 and needs no page table.  Every
+   page directory shares these mappings, since pagedir_create()
+   copies the kernel's PDEs from init_page_dir. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  const size_t large_pages = PTSPAN / PGSIZE;
+  bool pse = (cpuid_features () & CPUID_PSE) != 0;
+
+  /* Large pages must be enabled before CR3 points to a page
+     directory that uses them. */
+  if (pse)
+    set_cr4 (CR4_PSE);
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,6 +215,14 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (pse && pte_idx == 0 && page + large_pages <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true);
+          page += large_pages - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -186,6 +238,31 @@ paging_init (void)
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
+
+  /* Enable global pages, so that the kernel's TLB entries are not
+     flushed on every page directory switch.  See [IA32-v3a] 3.12
+     "Translation Lookaside Buffers (TLBs)". */
+  if (cpuid_features () & CPUID_PGE)
+    set_cr4 (CR4_PGE);
+}
+
+/* Returns the feature flags reported by the CPUID instruction in
+   EDX for leaf 1.  See [IA32-v2a] "CPUID--CPU Identification". */
+static uint32_t
+cpuid_features (void) 
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return edx;
+}
+
+/* Sets BITS in control register CR4. */
+static void
+set_cr4 (uint32_t bits) 
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4 | bits) : "memory");
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -256,13 +333,21 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-stride"))
+        thread_stride = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-vmstats"))
+        page_exit_stats = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
+  if (thread_mlfqs && thread_stride)
+    PANIC ("-mlfqs and -stride are mutually exclusive");
 
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -379,8 +464,12 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -stride            Use stride (proportional-share) scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -vmstats           Print paging statistics at process exit.\n"
 #endif
           );
   shutdown_power_off ();
@@ -32,7 +32,13 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   For each descriptor, and for big blocks, we count blocks and
+   arenas in use, the peak number of blocks, and failures, for
+   reporting in heap statistics.  Callers may also attribute the
+   blocks they allocate to a "tag" by using malloc_tagged() and
+   free_tagged(). */
 
 /* Descriptor. */
 struct desc
@@ -41,6 +47,12 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics, protected by `lock'. */
+    size_t block_cnt;           /* Blocks in use. */
+    size_t peak_block_cnt;      /* Most blocks ever in use. */
+    size_t arena_cnt;           /* Arenas in use. */
+    size_t failed_cnt;          /* Failed allocations. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -64,6 +76,20 @@ struct block
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics for big blocks, and the lock that protects them. */
+static struct lock big_lock;
+static size_t big_cnt;          /* Big blocks in use. */
+static size_t peak_big_cnt;     /* Most big blocks ever in use. */
+static size_t big_page_cnt;     /* Pages in big blocks. */
+static size_t big_failed_cnt;   /* Failed big block allocations. */
+
+/* All tags that have been used, and the lock that protects the
+   list.  Each tag's statistics have a lock of their own; see
+   struct malloc_tag. */
+static struct list tags;
+static struct lock tags_lock;
+
+static void register_tag (struct malloc_tag *);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -82,6 +108,10 @@ malloc_init (void)
       list_init (&d->free_list);
       lock_init (&d->lock);
     }
+  ASSERT (desc_cnt == HEAP_CLASS_CNT);
+  lock_init (&big_lock);
+  list_init (&tags);
+  lock_init (&tags_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -108,6 +138,17 @@ malloc (size_t size)
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
       a = palloc_get_multiple (0, page_cnt);
+
+      lock_acquire (&big_lock);
+      if (a != NULL)
+        {
+          if (++big_cnt > peak_big_cnt)
+            peak_big_cnt = big_cnt;
+          big_page_cnt += page_cnt;
+        }
+      else
+        big_failed_cnt++;
+      lock_release (&big_lock);
       if (a == NULL)
         return NULL;
 
@@ -130,9 +171,11 @@ malloc (size_t size)
       a = palloc_get_page (0);
       if (a == NULL) 
         {
+          d->failed_cnt++;
           lock_release (&d->lock);
           return NULL; 
         }
+      d->arena_cnt++;
 
       /* Initialize arena and add its blocks to the free list. */
       a->magic = ARENA_MAGIC;
@@ -149,6 +192,8 @@ malloc (size_t size)
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
   a->free_cnt--;
+  if (++d->block_cnt > d->peak_block_cnt)
+    d->peak_block_cnt = d->block_cnt;
   lock_release (&d->lock);
   return b;
 }
@@ -237,6 +282,7 @@ free (void *p)
 
           /* Add block to free list. */
           list_push_front (&d->free_list, &b->free_elem);
+          d->block_cnt--;
 
           /* If the arena is now entirely unused, free it. */
           if (++a->free_cnt >= d->blocks_per_arena) 
@@ -250,6 +296,7 @@ free (void *p)
                   list_remove (&b->free_elem);
                 }
               palloc_free_page (a);
+              d->arena_cnt--;
             }
 
           lock_release (&d->lock);
@@ -257,12 +304,182 @@ free (void *p)
       else
         {
           /* It's a big block.  Free its pages. */
+          lock_acquire (&big_lock);
+          big_cnt--;
+          big_page_cnt -= a->free_cnt;
+          lock_release (&big_lock);
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
     }
 }
 
+/* Obtains and returns a new block of at least SIZE bytes, as
+   malloc(), and attributes it to TAG.  The block must be freed
+   with free_tagged(), passing the same TAG. */
+void *
+malloc_tagged (size_t size, struct malloc_tag *tag)
+{
+  void *p = malloc (size);
+  if (p != NULL)
+    {
+      register_tag (tag);
+      lock_acquire (&tag->lock);
+      malloc_tag_alloc (tag, block_size (p));
+      lock_release (&tag->lock);
+    }
+  return p;
+}
+
+/* Frees block P, which must have been allocated with
+   malloc_tagged() using TAG. */
+void
+free_tagged (void *p, struct malloc_tag *tag)
+{
+  if (p != NULL)
+    {
+      lock_acquire (&tag->lock);
+      malloc_tag_free (tag, block_size (p));
+      lock_release (&tag->lock);
+      free (p);
+    }
+}
+
+/* Attributes an object of SIZE bytes to TAG, registering TAG if
+   this is its first use.  For allocators other than malloc() that
+   want their objects to appear in heap statistics.  The caller
+   must hold a lock that protects TAG's statistics. */
+void
+malloc_tag_alloc (struct malloc_tag *tag, size_t size)
+{
+  register_tag (tag);
+  tag->blocks++;
+  tag->bytes += size;
+  if (tag->bytes > tag->peak_bytes)
+    tag->peak_bytes = tag->bytes;
+}
+
+/* Removes an object of SIZE bytes, previously attributed with
+   malloc_tag_alloc(), from TAG.  The caller must hold a lock that
+   protects TAG's statistics. */
+void
+malloc_tag_free (struct malloc_tag *tag, size_t size)
+{
+  ASSERT (tag->blocks > 0 && tag->bytes >= size);
+  tag->blocks--;
+  tag->bytes -= size;
+}
+
+/* Adds TAG to the list of tags and initializes its lock, if this
+   has not already been done.  Takes tags_lock only for a tag's
+   first use. */
+static void
+register_tag (struct malloc_tag *tag)
+{
+  if (tag->elem.next != NULL)
+    return;
+
+  lock_acquire (&tags_lock);
+  if (tag->elem.next == NULL)
+    {
+      lock_init (&tag->lock);
+      list_push_back (&tags, &tag->elem);
+    }
+  lock_release (&tags_lock);
+}
+
+/* Stores statistics for each size class and for big blocks into
+   STATS.  Does not fill in STATS's pool statistics. */
+void
+malloc_get_stats (struct heapstats *stats)
+{
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct desc *d = &descs[i];
+      struct heap_class_stats *c = &stats->classes[i];
+
+      lock_acquire (&d->lock);
+      c->block_size = d->block_size;
+      c->blocks = d->block_cnt;
+      c->peak_blocks = d->peak_block_cnt;
+      c->arenas = d->arena_cnt;
+      c->failures = d->failed_cnt;
+      lock_release (&d->lock);
+    }
+
+  lock_acquire (&big_lock);
+  stats->big.block_size = 0;
+  stats->big.blocks = big_cnt;
+  stats->big.peak_blocks = peak_big_cnt;
+  stats->big.arenas = big_page_cnt;
+  stats->big.failures = big_failed_cnt;
+  lock_release (&big_lock);
+}
+
+/* Stores statistics for up to CNT tags into TAGS.
+   Returns the number of tags in use, which may exceed CNT.
+   Statistics are read without taking each tag's lock, so those
+   for a tag in use may be slightly out of date. */
+size_t
+malloc_get_tags (struct heap_tag_stats *tags_stats, size_t cnt)
+{
+  struct list_elem *e;
+  size_t i = 0;
+
+  lock_acquire (&tags_lock);
+  for (e = list_begin (&tags); e != list_end (&tags); e = list_next (e))
+    {
+      struct malloc_tag *tag = list_entry (e, struct malloc_tag, elem);
+      if (i < cnt)
+        {
+          struct heap_tag_stats *t = &tags_stats[i];
+          strlcpy (t->name, tag->name, sizeof t->name);
+          t->blocks = tag->blocks;
+          t->bytes = tag->bytes;
+          t->peak_bytes = tag->peak_bytes;
+        }
+      i++;
+    }
+  lock_release (&tags_lock);
+  return i;
+}
+
+/* Prints heap statistics: each size class and tag that has ever
+   been used, and big blocks. */
+void
+malloc_print_stats (void)
+{
+  struct heapstats stats;
+  struct list_elem *e;
+  size_t i;
+
+  malloc_get_stats (&stats);
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct heap_class_stats *c = &stats.classes[i];
+      if (c->peak_blocks > 0 || c->failures > 0)
+        printf ("Heap: %u-byte blocks: %u in use (peak %u), "
+                "%u arenas, %u failures\n",
+                c->block_size, c->blocks, c->peak_blocks, c->arenas,
+                c->failures);
+    }
+  printf ("Heap: big blocks: %u in use (peak %u), %u pages, "
+          "%u failures\n",
+          stats.big.blocks, stats.big.peak_blocks, stats.big.arenas,
+          stats.big.failures);
+
+  lock_acquire (&tags_lock);
+  for (e = list_begin (&tags); e != list_end (&tags); e = list_next (e))
+    {
+      struct malloc_tag *tag = list_entry (e, struct malloc_tag, elem);
+      printf ("Heap: %s: %zu objects, %zu bytes (peak %zu)\n",
+              tag->name, tag->blocks, tag->bytes, tag->peak_bytes);
+    }
+  lock_release (&tags_lock);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
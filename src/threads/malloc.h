@@ -2,7 +2,32 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <heapstats.h>
+#include <list.h>
 #include <stddef.h>
+#include "threads/synch.h"
+
+/* An allocation-site tag.  Memory allocated through a tag is
+   attributed to it in heap statistics, so that it is possible to
+   see which subsystem is holding memory.  Declare tags with
+   static storage duration, initialized with MALLOC_TAG().
+
+   A tag's statistics are protected by `lock' if the tag is used
+   with malloc_tagged() and free_tagged(), and otherwise by
+   whatever lock the caller of malloc_tag_alloc() and
+   malloc_tag_free() holds. */
+struct malloc_tag
+  {
+    const char *name;           /* Name, for reports. */
+    struct list_elem elem;      /* Element in list of all tags. */
+    struct lock lock;           /* Set up when added to the list. */
+    size_t blocks;              /* Objects allocated. */
+    size_t bytes;               /* Bytes allocated. */
+    size_t peak_bytes;          /* Most bytes ever allocated. */
+  };
+
+/* Initializer for a struct malloc_tag named NAME. */
+#define MALLOC_TAG(NAME) { .name = (NAME) }
 
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
@@ -10,4 +35,13 @@ void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
 
+void *malloc_tagged (size_t, struct malloc_tag *) __attribute__ ((malloc));
+void free_tagged (void *, struct malloc_tag *);
+void malloc_tag_alloc (struct malloc_tag *, size_t);
+void malloc_tag_free (struct malloc_tag *, size_t);
+
+void malloc_get_stats (struct heapstats *);
+size_t malloc_get_tags (struct heap_tag_stats *, size_t cnt);
+void malloc_print_stats (void);
+
 #endif /* threads/malloc.h */
@@ -2,13 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +24,94 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a binary buddy system.  A free block
+   of 2**K pages, where K is the block's "order", begins at a
+   page index that is a multiple of 2**K and is kept on the
+   pool's free list for order K.  Allocating takes a block from
+   the smallest nonempty list that is big enough, splitting it
+   in half as many times as needed, and freeing merges a block
+   with its "buddy", the other half of the block it was split
+   from, for as long as the buddy is also free.  Both take time
+   logarithmic in the size of the pool, and because freed blocks
+   are merged back together, large allocations keep succeeding
+   even after a long run of mixed-size allocations.
+
+   A request for a number of pages that is not a power of 2 is
+   satisfied from a block of the next larger order, and the pages
+   beyond those requested are freed again immediately.  Freeing
+   any run of pages splits it into aligned blocks, so pages may
+   be freed in different groups than they were allocated in.
+
+   To keep PAL_ZERO requests off the critical path, the idle
+   thread takes free pages out of the buddy system, zeros them,
+   and keeps them on a separate list, from which single-page
+   PAL_ZERO requests are satisfied first.  Zeroed pages are still
+   free: other single-page requests fall back on them, and
+   multi-page requests return them to the buddy system if they
+   cannot otherwise be met.
+
+   Caches that hold memory they could give back register
+   "shrinkers".  When a request cannot be met, the shrinkers are
+   asked to free at least as many pages as were requested, and
+   the request is tried again before it fails.  This lets caches
+   grow freely into memory that would otherwise go unused.
+
+   palloc_free_page() is called by thread_schedule_tail() with
+   interrupts off, where it may not block, so a pool's free lists
+   are protected by disabling interrupts rather than by a lock. */
+
+/* Number of block orders.  A pool can have up to 2**(ORDER_CNT -
+   1) pages in a single block, more than physical memory has. */
+#define ORDER_CNT 19
+
+/* Information about a page, meaningful only for the first page
+   in a free block or for a zeroed page.  Kept apart from the
+   page itself, so that free pages are never written. */
+struct buddy
+  {
+    struct list_elem elem;              /* Free or zeroed list elem. */
+    uint8_t order;                      /* Order of free block. */
+    bool free;                          /* First page of free block? */
+  };
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct bitmap *used_map;            /* Bitmap of used pages. */
+    struct buddy *buddies;              /* One per page. */
+    struct list free[ORDER_CNT];        /* Free blocks of each order. */
+    size_t free_cnt;                    /* Pages in free lists. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages. */
+
+    struct list zeroed;                 /* Free pages already zeroed. */
+    size_t zeroed_cnt;                  /* Zeroed or being zeroed. */
+    size_t zeroed_max;                  /* Most zeroed pages to keep. */
+
+    size_t peak_used;                   /* Most pages ever in use. */
+    size_t failed_cnt;                  /* Failed allocations. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Registered shrinkers.  Only added to, with interrupts off. */
+static struct list shrinkers;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static size_t take_zeroed (struct pool *);
+static bool flush_zeroed (struct pool *);
+static bool zero_page (struct pool *);
+static size_t pool_used (const struct pool *);
+static size_t try_alloc (struct pool *, enum palloc_flags,
+                         size_t page_cnt, bool *zeroed);
+static bool shrink (size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -51,6 +124,8 @@ palloc_init (size_t user_page_limit)
   size_t free_pages = (free_end - free_start) / PGSIZE;
   size_t user_pages = free_pages / 2;
   size_t kernel_pages;
+
+  list_init (&shrinkers);
   if (user_pages > user_page_limit)
     user_pages = user_page_limit;
   kernel_pages = free_pages - user_pages;
@@ -73,13 +148,28 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
   size_t page_idx;
+  bool zeroed;
+  enum intr_level old_level;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  /* The caches that register shrinkers hold kernel memory, so
+     only kernel pool requests are worth retrying. */
+  page_idx = try_alloc (pool, flags, page_cnt, &zeroed);
+  if (page_idx == BITMAP_ERROR && pool == &kernel_pool
+      && shrink (page_cnt))
+    page_idx = try_alloc (pool, flags, page_cnt, &zeroed);
+
+  old_level = intr_disable ();
+  if (page_idx != BITMAP_ERROR)
+    {
+      if (pool_used (pool) > pool->peak_used)
+        pool->peak_used = pool_used (pool);
+    }
+  else
+    pool->failed_cnt++;
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -88,7 +178,7 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -119,6 +209,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -137,8 +228,84 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_pages (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
+}
+
+/* Tries to allocate PAGE_CNT contiguous pages from POOL, as
+   palloc_get_multiple() does, except that it does not zero them
+   or call shrinkers.  Returns the index of the first page, or
+   BITMAP_ERROR on failure.  Sets *ZEROED to true if the page is
+   known to be zeroed already, false otherwise. */
+static size_t
+try_alloc (struct pool *pool, enum palloc_flags flags, size_t page_cnt,
+           bool *zeroed)
+{
+  size_t page_idx = BITMAP_ERROR;
+  enum intr_level old_level;
+
+  *zeroed = false;
+  old_level = intr_disable ();
+  if (page_cnt == 1 && (flags & PAL_ZERO))
+    {
+      page_idx = take_zeroed (pool);
+      *zeroed = page_idx != BITMAP_ERROR;
+    }
+  if (page_idx == BITMAP_ERROR)
+    page_idx = alloc_pages (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR)
+    {
+      /* Fall back on the pages set aside by the idle thread. */
+      if (page_cnt == 1)
+        {
+          page_idx = take_zeroed (pool);
+          *zeroed = page_idx != BITMAP_ERROR;
+        }
+      else if (flush_zeroed (pool))
+        page_idx = alloc_pages (pool, page_cnt);
+    }
+  if (page_idx != BITMAP_ERROR)
+    {
+      ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+    }
+  intr_set_level (old_level);
+  return page_idx;
+}
+
+/* Registers shrinker S, to be called when memory is short. */
+void
+palloc_register_shrinker (struct shrinker *s)
+{
+  enum intr_level old_level = intr_disable ();
+  list_push_back (&shrinkers, &s->elem);
+  intr_set_level (old_level);
+}
+
+/* Asks the registered shrinkers to free PAGE_CNT pages in all.
+   Returns true if any pages were freed, false otherwise.  Does
+   nothing in an interrupt handler or with interrupts off, where
+   shrinkers could not safely run. */
+static bool
+shrink (size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t freed = 0;
+
+  if (intr_context () || intr_get_level () == INTR_OFF)
+    return false;
+
+  for (e = list_begin (&shrinkers);
+       e != list_end (&shrinkers) && freed < page_cnt;
+       e = list_next (e))
+    {
+      struct shrinker *s = list_entry (e, struct shrinker, elem);
+      freed += s->shrink (page_cnt - freed);
+    }
+  return freed > 0;
 }
 
 /* Frees the page at PAGE. */
@@ -148,15 +315,74 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeros one free page in the background, for later PAL_ZERO
+   requests.  Called by the idle thread, with interrupts on.
+   Returns true if a page was zeroed, false if enough pages are
+   already zeroed or memory is too short to set more aside. */
+bool
+palloc_zero_idle (void)
+{
+  return zero_page (&kernel_pool) || zero_page (&user_pool);
+}
+
+/* Returns the number of pages in POOL that are in use, not
+   counting zeroed pages, which are still free. */
+static size_t
+pool_used (const struct pool *pool)
+{
+  return pool->page_cnt - pool->free_cnt - pool->zeroed_cnt;
+}
+
+/* Stores statistics for POOL into STATS. */
+static void
+get_pool_stats (const struct pool *pool, struct heap_pool_stats *stats)
+{
+  enum intr_level old_level = intr_disable ();
+  stats->pages = pool->page_cnt;
+  stats->used = pool_used (pool);
+  stats->peak_used = pool->peak_used;
+  stats->failures = pool->failed_cnt;
+  intr_set_level (old_level);
+}
+
+/* Stores statistics for the kernel and user pools into STATS. */
+void
+palloc_get_stats (struct heapstats *stats)
+{
+  get_pool_stats (&kernel_pool, &stats->kernel_pool);
+  get_pool_stats (&user_pool, &stats->user_pool);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void)
+{
+  struct heapstats stats;
+
+  palloc_get_stats (&stats);
+  printf ("Pages: kernel pool %u of %u in use (peak %u), "
+          "%u failures; user pool %u of %u in use (peak %u), "
+          "%u failures\n",
+          stats.kernel_pool.used, stats.kernel_pool.pages,
+          stats.kernel_pool.peak_used, stats.kernel_pool.failures,
+          stats.user_pool.used, stats.user_pool.pages,
+          stats.user_pool.peak_used, stats.user_pool.failures);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's used_map and buddies at its base.
+     Calculate the space needed for them
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (bm_size
+                                  + page_cnt * sizeof (struct buddy),
+                                  PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +390,20 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->buddies = (struct buddy *) ((uint8_t *) base + bm_size);
+  memset (p->buddies, 0, page_cnt * sizeof *p->buddies);
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init (&p->free[order]);
   p->base = base + bm_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  free_pages (p, 0, page_cnt);
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->zeroed_max = page_cnt / 16;
+  p->peak_used = 0;
+  p->failed_cnt = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +413,159 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Puts the block of order ORDER starting at page PAGE_IDX on
+   POOL's free list for that order. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order)
+{
+  struct buddy *b = &pool->buddies[page_idx];
+
+  b->order = order;
+  b->free = true;
+  list_push_front (&pool->free[order], &b->elem);
+}
+
+/* Frees the block of order ORDER starting at page PAGE_IDX in
+   POOL, merging it with its buddy as many times as possible. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  for (; order + 1 < ORDER_CNT; order++)
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+      struct buddy *b = &pool->buddies[buddy_idx];
+
+      if (buddy_idx + ((size_t) 1 << order) > pool->page_cnt
+          || !b->free || b->order != order)
+        break;
+      list_remove (&b->elem);
+      b->free = false;
+      page_idx &= ~((size_t) 1 << order);
+    }
+  push_block (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages in POOL starting at page PAGE_IDX, as
+   a series of the largest blocks that are properly aligned. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  pool->free_cnt += page_cnt;
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order + 1 < ORDER_CNT
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL.  Returns the
+   index of the first page, or BITMAP_ERROR if there is no free
+   block large enough. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt)
+{
+  struct buddy *b;
+  size_t page_idx;
+  int order, k;
+
+  /* Find the smallest order that fits, then the smallest free
+     block of at least that order. */
+  for (order = 0; ((size_t) 1 << order) < page_cnt; order++)
+    if (order + 1 >= ORDER_CNT)
+      return BITMAP_ERROR;
+  for (k = order; k < ORDER_CNT; k++)
+    if (!list_empty (&pool->free[k]))
+      break;
+  if (k >= ORDER_CNT)
+    return BITMAP_ERROR;
+
+  b = list_entry (list_pop_front (&pool->free[k]), struct buddy, elem);
+  b->free = false;
+  page_idx = b - pool->buddies;
+
+  /* Split the block down to the size we need, then give back
+     the pages past the end of the request. */
+  while (k > order)
+    {
+      k--;
+      push_block (pool, page_idx + ((size_t) 1 << k), k);
+    }
+  pool->free_cnt -= (size_t) 1 << order;
+  free_pages (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  return page_idx;
+}
+
+/* Removes a page from POOL's zeroed list and returns its index,
+   or BITMAP_ERROR if the list is empty.
+   Must be called with interrupts off. */
+static size_t
+take_zeroed (struct pool *pool)
+{
+  struct buddy *b;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&pool->zeroed))
+    return BITMAP_ERROR;
+  b = list_entry (list_pop_front (&pool->zeroed), struct buddy, elem);
+  pool->zeroed_cnt--;
+  return b - pool->buddies;
+}
+
+/* Returns all the pages in POOL's zeroed list to its buddy
+   system.  Returns true if there were any, false otherwise.
+   Must be called with interrupts off. */
+static bool
+flush_zeroed (struct pool *pool)
+{
+  bool flushed = false;
+  size_t page_idx;
+
+  while ((page_idx = take_zeroed (pool)) != BITMAP_ERROR)
+    {
+      free_pages (pool, page_idx, 1);
+      flushed = true;
+    }
+  return flushed;
+}
+
+/* Takes a free page from POOL, zeros it, and adds it to POOL's
+   zeroed list, if POOL needs more zeroed pages and has plenty of
+   free memory.  Returns true if successful, false otherwise.
+   The page is zeroed with interrupts on, so that the idle thread
+   can be preempted as usual. */
+static bool
+zero_page (struct pool *pool)
+{
+  size_t page_idx = BITMAP_ERROR;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt < pool->zeroed_max
+      && pool->free_cnt > pool->zeroed_max)
+    page_idx = alloc_pages (pool, 1);
+  if (page_idx != BITMAP_ERROR)
+    pool->zeroed_cnt++;
+  intr_set_level (old_level);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  memset (pool->base + PGSIZE * page_idx, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  list_push_back (&pool->zeroed, &pool->buddies[page_idx].elem);
+  intr_set_level (old_level);
+  return true;
+}
@@ -1,6 +1,9 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <heapstats.h>
+#include <list.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +14,28 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* A reclaim callback, registered by a cache that can give back
+   memory when the page allocator runs short.  SHRINK should free
+   about PAGE_CNT pages, or as many as it can, and return the
+   number actually freed.  It is called from whatever thread
+   failed to allocate, which may hold any lock, so it must not
+   wait for a lock: use lock_try_acquire() and skip whatever it
+   cannot lock. */
+struct shrinker
+  {
+    const char *name;                   /* Name, for debugging. */
+    size_t (*shrink) (size_t page_cnt); /* Reclaim callback. */
+    struct list_elem elem;              /* Element in shrinker list. */
+  };
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_zero_idle (void);
+void palloc_register_shrinker (struct shrinker *);
+void palloc_get_stats (struct heapstats *);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
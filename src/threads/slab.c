@@ -0,0 +1,255 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Object caches.
+
+   malloc() rounds each request up to a power of 2, which wastes
+   up to half of each block, and shares each size class among
+   every kind of object of about that size.  An object cache
+   instead hands out objects of a single type, in slots of
+   exactly that type's size.
+
+   Each cache obtains pages, called "slabs", from the page
+   allocator and divides each one into a header followed by as
+   many slots as fit.  Free slots are chained through their first
+   word into a list kept in the slab's header.  Slabs that have
+   both free and allocated slots are kept on the cache's
+   "partial" list, and slabs with no allocated slots on its
+   "empty" list, so that allocating and freeing an object take
+   constant time.
+
+   Empty slabs are kept for reuse rather than returned to the
+   page allocator right away.  A shrinker gives them back when
+   the page allocator runs short of memory.
+
+   Each cache's objects are attributed to a malloc() tag with the
+   cache's name, so that they appear in heap statistics. */
+
+/* An object cache. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for debugging. */
+    size_t obj_size;            /* Size of each slot in bytes. */
+    size_t objs_per_slab;       /* Number of slots in a slab. */
+    void (*ctor) (void *);      /* Called on each new object, or null. */
+    struct list partial;        /* Slabs with some slots free. */
+    struct list empty;          /* Slabs with all slots free. */
+    struct lock lock;           /* Protects the cache and its slabs. */
+    struct malloc_tag tag;      /* Tag for objects in use, under `lock'. */
+    struct list_elem elem;      /* Element in `caches'. */
+  };
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab0bad
+
+/* Slab header, at the beginning of each slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's slab list. */
+    size_t free_cnt;            /* Number of free slots. */
+    void *free;                 /* First free slot, or null. */
+  };
+
+/* All caches, and the lock that protects the list. */
+static struct list caches;
+static struct lock caches_lock;
+
+static size_t shrink_caches (size_t page_cnt);
+static struct shrinker slab_shrinker = {"slab", shrink_caches, {NULL, NULL}};
+
+/* Initializes the object cache allocator. */
+void
+slab_init (void)
+{
+  list_init (&caches);
+  lock_init (&caches_lock);
+  palloc_register_shrinker (&slab_shrinker);
+}
+
+/* Creates and returns a cache of objects SIZE bytes in size,
+   named NAME, which must remain valid for as long as the cache
+   exists.  If CTOR is nonnull, it is called to initialize each
+   object as it is allocated.  Panics if memory is not
+   available, since caches are created at initialization time. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, void (*ctor) (void *))
+{
+  struct kmem_cache *c;
+
+  size = ROUND_UP (size > 0 ? size : 1, sizeof (void *));
+  ASSERT (size <= PGSIZE - sizeof (struct slab));
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    PANIC ("%s: out of memory for object cache", name);
+  c->name = name;
+  c->obj_size = size;
+  c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / size;
+  c->ctor = ctor;
+  list_init (&c->partial);
+  list_init (&c->empty);
+  lock_init (&c->lock);
+  c->tag = (struct malloc_tag) MALLOC_TAG (name);
+
+  lock_acquire (&caches_lock);
+  list_push_back (&caches, &c->elem);
+  lock_release (&caches_lock);
+  return c;
+}
+
+/* Obtains a new slab for cache C, puts all of its slots on its
+   free list, and adds it to C's empty list.  Returns true if
+   successful, false if memory is not available.
+   C's lock must be held. */
+static bool
+add_slab (struct kmem_cache *c)
+{
+  struct slab *s;
+  uint8_t *obj;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return false;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  s->free = NULL;
+  obj = (uint8_t *) (s + 1) + c->obj_size * c->objs_per_slab;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      obj -= c->obj_size;
+      *(void **) obj = s->free;
+      s->free = obj;
+    }
+  list_push_front (&c->empty, &s->elem);
+  return true;
+}
+
+/* Allocates and returns an object from cache C, initialized by
+   C's constructor if it has one.  Returns a null pointer if
+   memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+  if (list_empty (&c->partial))
+    {
+      /* Start using an empty slab. */
+      if (list_empty (&c->empty) && !add_slab (c))
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, list_pop_front (&c->empty));
+    }
+
+  s = list_entry (list_front (&c->partial), struct slab, elem);
+  obj = s->free;
+  s->free = *(void **) obj;
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+  malloc_tag_alloc (&c->tag, c->obj_size);
+  lock_release (&c->lock);
+
+  if (c->ctor != NULL)
+    c->ctor (obj);
+  return obj;
+}
+
+/* Returns the slab that object OBJ, from cache C, is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT ((pg_ofs (obj) - sizeof *s) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Frees OBJ, which must have been allocated from cache C.
+   Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+  s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  malloc_tag_free (&c->tag, c->obj_size);
+  *(void **) obj = s->free;
+  s->free = obj;
+  if (s->free_cnt++ > 0)
+    list_remove (&s->elem);
+  if (s->free_cnt < c->objs_per_slab)
+    list_push_front (&c->partial, &s->elem);
+  else
+    list_push_front (&c->empty, &s->elem);
+  lock_release (&c->lock);
+}
+
+/* Shrinker for object caches.  Frees empty slabs until PAGE_CNT
+   pages have been freed, skipping any cache that is locked, and
+   returns the number of pages freed.
+
+   The shrinker runs in the thread whose page allocation failed,
+   which may be kmem_cache_alloc() itself, holding a cache's lock
+   in add_slab().  lock_try_acquire() may not be used on a lock
+   that the caller already holds, so such locks are checked for
+   and skipped first. */
+static size_t
+shrink_caches (size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t freed = 0;
+
+  if (lock_held_by_current_thread (&caches_lock)
+      || !lock_try_acquire (&caches_lock))
+    return 0;
+  for (e = list_begin (&caches); e != list_end (&caches) && freed < page_cnt;
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      if (!lock_held_by_current_thread (&c->lock)
+          && lock_try_acquire (&c->lock))
+        {
+          while (!list_empty (&c->empty) && freed < page_cnt)
+            {
+              palloc_free_page (list_entry (list_pop_front (&c->empty),
+                                            struct slab, elem));
+              freed++;
+            }
+          lock_release (&c->lock);
+        }
+    }
+  lock_release (&caches_lock);
+  return freed;
+}
@@ -2,11 +2,15 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
@@ -21,9 +25,17 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queues of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running, one
+   per priority.  Bit P of ready_mask is set if ready_queues[P] is
+   not empty, so that the highest priority ready thread can be
+   found in constant time.  With PRI_CNT == 64, the mask is kept
+   as 32-bit words, so that finding its highest set bit needs no
+   64-bit library support. */
+#define READY_WORDS DIV_ROUND_UP (PRI_CNT, 32)
+static struct list ready_queues[PRI_CNT];
+static uint32_t ready_mask[READY_WORDS];
+static int ready_cnt;           /* Number of ready threads. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -38,6 +50,55 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Stride scheduler.
+
+   Threads belong to ticket groups, which stand for tenants.  A
+   new thread joins its creator's group, so a tenant's threads
+   and processes all share its tickets, and the CPU is divided
+   among groups in proportion to their tickets however many
+   threads each one runs.
+
+   Each thread has a pass, its virtual time.  The ready thread
+   with the lowest pass runs next, and each tick that a thread
+   runs advances its pass by its stride, STRIDE1 times the
+   number of runnable threads in its group divided by the
+   group's tickets.  A thread that wakes up is not credited for
+   the time it slept: its pass is raised to at least that of the
+   thread last chosen to run, stride_vtime. */
+#define STRIDE1 (1 << 20)       /* Stride of a thread with 1 ticket. */
+static struct rbtree stride_queue;      /* Ready threads, by pass. */
+static int64_t stride_vtime;            /* Pass of last thread chosen. */
+
+/* A ticket group. */
+struct stride_group
+  {
+    struct stride_group *parent; /* Group that funded this one. */
+    int tickets;                /* Share of the CPU. */
+    int ref_cnt;                /* # of member threads and subgroups. */
+    int runnable_cnt;           /* # of ready or running members. */
+  };
+
+/* Group that the initial thread and other kernel threads belong
+   to.  Its kernel threads can create groups with new tickets,
+   whereas other groups can only give some of their own tickets
+   to a subgroup.  User processes never run in it: each process
+   started from it gets a group of its own. */
+static struct stride_group root_group;
+
+/* Earliest-deadline-first real-time class.
+
+   A thread that reserves BUDGET ticks out of every PERIOD ticks
+   runs ahead of every thread in the other classes, and ahead of
+   real-time threads whose periods end later, until it has used
+   up its budget for the current period.  Then it is throttled:
+   it waits in rt_throttled for its period to end, and competes
+   for the CPU like any other thread meanwhile.  Admission control
+   keeps the sum of reserved shares within RT_UTIL_MAX, which
+   lets every admitted thread meet its deadlines. */
+static struct heap rt_ready;    /* Ready unthrottled threads. */
+static struct heap rt_throttled; /* Throttled threads. */
+static int rt_util;             /* Sum of reserved CPU shares. */
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -60,10 +121,50 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the stride scheduler.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+
+/* Multi-level feedback queue scheduler.
+
+   Once a second, each thread's recent_cpu decays by a factor
+   that depends on the load average, which changes its priority.
+   Rather than walking every thread at once, with interrupts off,
+   the decay is applied to DECAY_BATCH threads per tick, starting
+   at decay_cursor in all_list, so that each tick does a bounded
+   amount of work.  A thread's decay_epoch tells whether it has
+   been decayed yet this second, so that threads that start
+   running or are created in the middle of a walk are decayed
+   exactly once. */
+#define DECAY_BATCH 8           /* # of threads to decay per tick. */
+static int64_t sched_ticks;     /* # of timer ticks so far. */
+static fixed_point_t load_avg;  /* System load average. */
+static fixed_point_t decay_coef; /* recent_cpu decay factor this second. */
+static unsigned decay_epoch;    /* # of seconds of decay so far. */
+static struct list_elem *decay_cursor; /* Next thread to decay. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
+static bool ready_empty (void);
+static int ready_max_priority (void);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static void set_priority (struct thread *, int priority);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static void mlfqs_decay (struct thread *);
+static bool pass_less (const struct rb_elem *, const struct rb_elem *,
+                       void *aux);
+static void group_leave (struct thread *);
+static bool rt_active (const struct thread *);
+static bool deadline_less (const struct heap_elem *, const struct heap_elem *,
+                           void *aux);
+static void rt_new_period (struct thread *, int64_t now);
+static void rt_leave (struct thread *);
+static void rt_replenish (int64_t now);
+static bool queues_empty (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
@@ -88,16 +189,26 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
   list_init (&all_list);
+  decay_cursor = list_end (&all_list);
+  rb_init (&stride_queue, pass_less, NULL);
+  heap_init (&rt_ready, deadline_less, NULL);
+  heap_init (&rt_throttled, deadline_less, NULL);
+  root_group.tickets = TICKETS_DEFAULT;
+  root_group.ref_cnt = 1;
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
+  root_group.runnable_cnt++;
   initial_thread->tid = allocate_tid ();
 }
 
@@ -124,6 +235,7 @@ void
 thread_tick (void) 
 {
   struct thread *t = thread_current ();
+  int64_t now = timer_ticks ();
 
   /* Update statistics. */
   if (t == idle_thread)
@@ -135,17 +247,54 @@ thread_tick (void)
   else
     kernel_ticks++;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+  else if (thread_stride && t->group != NULL)
+    t->pass += ((int64_t) STRIDE1 * t->group->runnable_cnt
+                / t->group->tickets);
+
+  /* Charge a real-time thread for the tick, and throttle it once
+     it has used up its budget.  Then start new periods for
+     threads whose periods are over. */
+  if (rt_active (t))
+    {
+      if (now >= t->rt_deadline)
+        rt_new_period (t, now);
+      if (--t->rt_remaining == 0)
+        {
+          heap_insert (&rt_throttled, &t->rt_elem);
+          intr_yield_on_return ();
+        }
+    }
+  rt_replenish (now);
+
+  /* Enforce preemption.  A real-time thread is not time-sliced,
+     but thread_preempt() lets a thread whose period ends sooner
+     take over. */
+  if (++thread_ticks >= TIME_SLICE && !rt_active (t))
     intr_yield_on_return ();
 }
 
-/* Prints thread statistics. */
+/* Accounts CNT timer ticks that passed without a timer interrupt
+   while the idle thread was running. */
+void
+thread_idle_ticks (int64_t cnt)
+{
+  idle_ticks += cnt;
+  if (thread_mlfqs)
+    while (cnt-- > 0)
+      mlfqs_tick (idle_thread);
+}
+
+/* Prints thread statistics, followed by the page allocator's and
+   malloc()'s. */
 void
 thread_print_stats (void) 
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  palloc_print_stats ();
+  malloc_print_stats ();
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -160,9 +309,8 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, it runs before thread_create() returns. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -180,9 +328,21 @@ thread_create (const char *name, int priority,
   if (t == NULL)
     return TID_ERROR;
 
-  /* Initialize thread. */
+  /* Initialize thread.  Under the multi-level feedback queue
+     scheduler, it inherits our niceness and recent CPU use, and
+     its priority is computed from them. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  if (thread_mlfqs)
+    {
+      struct thread *cur = thread_current ();
+      enum intr_level old_level = intr_disable ();
+      t->nice = cur->nice;
+      t->recent_cpu = cur->recent_cpu;
+      t->decay_epoch = cur->decay_epoch;
+      mlfqs_update_priority (t);
+      intr_set_level (old_level);
+    }
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -199,8 +359,10 @@ thread_create (const char *name, int priority,
   sf->eip = switch_entry;
   sf->ebp = 0;
 
-  /* Add to run queue. */
+  /* Add to run queue, and run it now if it has a higher priority
+     than we do. */
   thread_unblock (t);
+  thread_preempt ();
 
   return tid;
 }
@@ -214,10 +376,15 @@ thread_create (const char *name, int priority,
 void
 thread_block (void) 
 {
+  struct thread *cur;
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  cur = thread_current ();
+  cur->status = THREAD_BLOCKED;
+  if (cur->group != NULL)
+    cur->group->runnable_cnt--;
   schedule ();
 }
 
@@ -238,8 +405,17 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
   t->status = THREAD_READY;
+  if (t->group != NULL)
+    t->group->runnable_cnt++;
+  if (t->rt_period != 0 && timer_ticks () >= t->rt_deadline)
+    {
+      /* Its period ended while it was blocked. */
+      if (t->rt_remaining == 0)
+        heap_remove (&rt_throttled, &t->rt_elem);
+      rt_new_period (t, timer_ticks ());
+    }
+  ready_push (t);
   intr_set_level (old_level);
 }
 
@@ -287,12 +463,17 @@ thread_exit (void)
   process_exit ();
 #endif
   syscall_exit ();
+  fpu_exit ();
+  group_leave (thread_current ());
   
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (decay_cursor == &thread_current ()->allelem)
+    decay_cursor = list_next (decay_cursor);
   list_remove (&thread_current()->allelem);
+  rt_leave (thread_current ());
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -309,13 +490,47 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
   cur->status = THREAD_READY;
+  if (cur != idle_thread) 
+    ready_push (cur);
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if a ready thread has a higher priority than the
+   running thread.  Within an interrupt handler, yields on return
+   from the interrupt instead.  The stride scheduler ignores
+   priorities, so under it this only ends idling.  A real-time
+   thread preempts any thread but a real-time thread whose period
+   ends no later. */
+void
+thread_preempt (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool preempt;
+
+  old_level = intr_disable ();
+  if (!heap_empty (&rt_ready))
+    preempt = (!rt_active (cur)
+               || (heap_entry (heap_min (&rt_ready), struct thread, rt_elem)
+                   ->rt_deadline < cur->rt_deadline));
+  else
+    preempt = (!queues_empty ()
+               && (cur == idle_thread
+                   || (!thread_stride && !rt_active (cur)
+                       && ready_max_priority () > cur->priority)));
+  intr_set_level (old_level);
+
+  if (preempt)
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -333,51 +548,465 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's priority to NEW_PRIORITY.  Priority
+   donated to it by other threads still applies.  Yields the CPU
+   if the thread no longer has the highest priority.  Ignored
+   under the multi-level feedback queue scheduler, which sets
+   priorities itself. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  ASSERT (new_priority >= PRI_MIN && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+
+  thread_current ()->base_priority = new_priority;
+  thread_update_priority ();
+  thread_preempt ();
+}
+
+/* Maximum depth of nested priority donation, to bound the time
+   spent following chains of locks. */
+#define DONATE_DEPTH 8
+
+/* Donates PRIORITY to thread T, which holds a lock that the
+   running thread is about to wait for, so that T does not wait
+   behind threads of lower priority than its waiters.  If T is
+   itself waiting for a lock, donates in turn to its holder, and
+   so on.  The multi-level feedback queue scheduler does not
+   donate priority.  Interrupts must be off. */
+void
+thread_donate_priority (struct thread *t, int priority) 
+{
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  for (depth = 0; t != NULL && depth < DONATE_DEPTH; depth++)
+    {
+      if (t->priority >= priority)
+        break;
+      set_priority (t, priority);
+      t = t->waiting_lock != NULL ? t->waiting_lock->holder : NULL;
+    }
+}
+
+/* Recomputes the running thread's priority as the higher of its
+   own priority and that of the highest priority thread waiting
+   for a lock that it holds.  Called when the thread's own
+   priority changes or it releases a lock, which withdraws the
+   donations of that lock's waiters. */
+void
+thread_update_priority (void) 
+{
+  struct thread *cur = thread_current ();
+  int priority = cur->base_priority;
+  struct list_elem *e, *w;
+  enum intr_level old_level;
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&cur->locks); e != list_end (&cur->locks);
+       e = list_next (e))
+    {
+      struct list *waiters = &list_entry (e, struct lock, elem)
+                               ->semaphore.waiters;
+      for (w = list_begin (waiters); w != list_end (waiters);
+           w = list_next (w))
+        {
+          struct thread *t = list_entry (w, struct thread, elem);
+          if (t->priority > priority)
+            priority = t->priority;
+        }
+    }
+  set_priority (cur, priority);
+  intr_set_level (old_level);
 }
 
-/* Returns the current thread's priority. */
+/* Returns the current thread's priority, including donations. */
 int
 thread_get_priority (void) 
 {
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, recomputes its
+   priority, and yields if it no longer has the highest
+   priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (nice >= NICE_MIN && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  mlfqs_decay (cur);
+  cur->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (cur);
+  intr_set_level (old_level);
+  thread_preempt ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fix_round (fix_scale (load_avg, 100));
+  intr_set_level (old_level);
+  return load_avg_100;
 }
 
-/* Returns 100 times the current thread's recent_cpu value. */
+/* Returns 100 times the current thread's recent_cpu value.
+   Applies this second's decay first, in case the walk through
+   all_list has not reached the current thread yet. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100;
+
+  mlfqs_decay (cur);
+  recent_cpu_100 = fix_round (fix_scale (cur->recent_cpu, 100));
+  intr_set_level (old_level);
+  return recent_cpu_100;
+}
+
+/* Computes T's priority under the multi-level feedback queue
+   scheduler from its recent CPU use and niceness, and moves it to
+   the matching run queue.  Interrupts must be off. */
+static void
+mlfqs_update_priority (struct thread *t) 
+{
+  int priority = fix_trunc (fix_sub (fix_int (PRI_MAX - t->nice * 2),
+                                     fix_unscale (t->recent_cpu, 4)));
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  t->base_priority = priority;
+  set_priority (t, priority);
+}
+
+/* Applies this second's decay to T's recent CPU use, if it has
+   not been applied yet.  Interrupts must be off. */
+static void
+mlfqs_decay (struct thread *t) 
+{
+  if (t->decay_epoch != decay_epoch)
+    {
+      t->recent_cpu = fix_add (fix_mul (decay_coef, t->recent_cpu),
+                               fix_int (t->nice));
+      t->decay_epoch = decay_epoch;
+    }
+}
+
+/* Decays the recent CPU use of the thread at decay_cursor, and
+   advances the cursor. */
+static void
+mlfqs_decay_next (void) 
+{
+  struct thread *t = list_entry (decay_cursor, struct thread, allelem);
+
+  decay_cursor = list_next (decay_cursor);
+  if (t != idle_thread)
+    {
+      mlfqs_decay (t);
+      mlfqs_update_priority (t);
+    }
+}
+
+/* Does the multi-level feedback queue scheduler's work for a
+   timer tick during which thread T ran.  Runs in an external
+   interrupt context, or with interrupts off. */
+static void
+mlfqs_tick (struct thread *t) 
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  sched_ticks++;
+  if (t != idle_thread)
+    t->recent_cpu = fix_add (t->recent_cpu, fix_int (1));
+
+  /* Once a second, update the load average and start decaying
+     every thread's recent CPU use, after finishing last second's
+     decay if it isn't done yet. */
+  if (sched_ticks % TIMER_FREQ == 0)
+    {
+      int ready_threads = ready_cnt + (t != idle_thread);
+      fixed_point_t twice_load;
+
+      while (decay_cursor != list_end (&all_list))
+        mlfqs_decay_next ();
+      load_avg = fix_add (fix_mul (fix_frac (59, 60), load_avg),
+                          fix_scale (fix_frac (1, 60), ready_threads));
+      twice_load = fix_scale (load_avg, 2);
+      decay_coef = fix_div (twice_load, fix_add (twice_load, fix_int (1)));
+      decay_epoch++;
+      decay_cursor = list_begin (&all_list);
+    }
+  for (i = 0; i < DECAY_BATCH && decay_cursor != list_end (&all_list); i++)
+    mlfqs_decay_next ();
+
+  /* Only the running thread's recent CPU use changes between
+     seconds, so only its priority needs updating in between. */
+  if (sched_ticks % 4 == 0 && t != idle_thread)
+    {
+      mlfqs_decay (t);
+      mlfqs_update_priority (t);
+    }
 }
 
+/* Moves the running thread into a new ticket group that has
+   TICKETS tickets.  Threads it creates afterward join the new
+   group too.  Only a kernel thread in the root group gets new
+   tickets.  Otherwise the tickets come out of the current group,
+   which must keep at least one, so that a tenant cannot enlarge
+   its share.  Returns true if successful, false if TICKETS is
+   out of range or memory is short. */
+bool
+thread_set_tickets (int tickets) 
+{
+  struct thread *cur = thread_current ();
+  struct stride_group *old = cur->group;
+  struct stride_group *g;
+  enum intr_level old_level;
+  bool mint = old == &root_group;
+
+#ifdef USERPROG
+  if (cur->pagedir != NULL)
+    mint = false;
+#endif
+
+  if (tickets < 1 || tickets > TICKETS_MAX)
+    return false;
+  g = malloc (sizeof *g);
+  if (g == NULL)
+    return false;
+  g->parent = old;
+  g->tickets = tickets;
+  g->ref_cnt = 1;
+  g->runnable_cnt = 1;
+
+  old_level = intr_disable ();
+  if (!mint)
+    {
+      if (old->tickets <= tickets)
+        {
+          intr_set_level (old_level);
+          free (g);
+          return false;
+        }
+      old->tickets -= tickets;
+    }
+  old->ref_cnt++;
+  intr_set_level (old_level);
+
+  /* The new group keeps the old one alive, so this does not
+     free it. */
+  group_leave (cur);
+  cur->group = g;
+  return true;
+}
+
+/* Moves the running thread, if it is in the root group, into a
+   group of its own with TICKETS_DEFAULT tickets.  Called as each
+   user process starts, before it has an address space, so that
+   every process that the kernel starts is a tenant with its own
+   share, which it and its children can only subdivide.  Returns
+   false if memory is short. */
+bool
+thread_new_tenant (void) 
+{
+  if (thread_current ()->group != &root_group)
+    return true;
+  return thread_set_tickets (TICKETS_DEFAULT);
+}
+
+/* Returns the number of tickets of the running thread's ticket
+   group. */
+int
+thread_get_tickets (void) 
+{
+  return thread_current ()->group->tickets;
+}
+
+/* Reserves BUDGET ticks of CPU time out of every PERIOD ticks
+   for the running thread, which moves it into the real-time
+   class, or takes it out of the class if PERIOD is 0.  Returns
+   false, leaving any earlier reservation in place, if the
+   arguments are invalid or the reservation would bring the
+   total reserved share above RT_UTIL_MAX. */
+bool
+thread_set_realtime (int period, int budget) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int util = 0;
+
+  if (period != 0)
+    {
+      if (period < 0 || budget <= 0 || budget > period)
+        return false;
+      util = DIV_ROUND_UP ((int64_t) budget * RT_UTIL_SCALE, period);
+    }
+
+  old_level = intr_disable ();
+  if (rt_util - cur->rt_util + util > RT_UTIL_MAX)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  rt_leave (cur);
+  cur->rt_period = period;
+  cur->rt_budget = budget;
+  cur->rt_util = util;
+  rt_util += util;
+  rt_new_period (cur, timer_ticks ());
+  intr_set_level (old_level);
+
+  thread_preempt ();
+  return true;
+}
+
+/* Returns true if thread A's pass is less than thread B's,
+   false otherwise. */
+static bool
+pass_less (const struct rb_elem *a_, const struct rb_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct thread *a = rb_entry (a_, struct thread, stride_elem);
+  const struct thread *b = rb_entry (b_, struct thread, stride_elem);
+
+  return a->pass < b->pass;
+}
+
+/* Returns true if T is in the real-time class and has budget
+   left in its current period. */
+static bool
+rt_active (const struct thread *t) 
+{
+  return t->rt_period != 0 && t->rt_remaining > 0;
+}
+
+/* Returns true if the period of thread A ends before that of
+   thread B, false otherwise. */
+static bool
+deadline_less (const struct heap_elem *a_, const struct heap_elem *b_,
+               void *aux UNUSED) 
+{
+  const struct thread *a = heap_entry (a_, struct thread, rt_elem);
+  const struct thread *b = heap_entry (b_, struct thread, rt_elem);
+
+  return a->rt_deadline < b->rt_deadline;
+}
+
+/* Starts a new period for real-time thread T at tick NOW, with
+   its full budget.  T must not be in a run queue.  Interrupts
+   must be off. */
+static void
+rt_new_period (struct thread *t, int64_t now) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->rt_deadline = now + t->rt_period;
+  t->rt_remaining = t->rt_budget;
+}
+
+/* Takes running thread T out of the real-time class and releases
+   its reservation.  Interrupts must be off. */
+static void
+rt_leave (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->rt_period != 0 && t->rt_remaining == 0)
+    heap_remove (&rt_throttled, &t->rt_elem);
+  rt_util -= t->rt_util;
+  t->rt_period = t->rt_budget = t->rt_remaining = t->rt_util = 0;
+}
+
+/* Starts new periods, with full budgets, for throttled threads
+   whose periods ended by tick NOW, moving those that are ready
+   back into the real-time run queue.  Interrupts must be off. */
+static void
+rt_replenish (int64_t now) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!heap_empty (&rt_throttled))
+    {
+      struct thread *t = heap_entry (heap_min (&rt_throttled),
+                                     struct thread, rt_elem);
+      if (t->rt_deadline > now)
+        break;
+
+      heap_pop_min (&rt_throttled);
+      if (t->status == THREAD_READY)
+        {
+          ready_remove (t);
+          rt_new_period (t, now);
+          ready_push (t);
+        }
+      else
+        rt_new_period (t, now);
+    }
+}
+
+/* Removes T, which must be the running thread, from its ticket
+   group.  If that leaves the group empty, returns its tickets to
+   the group that funded it and frees it, and so on up. */
+static void
+group_leave (struct thread *t) 
+{
+  struct stride_group *g = t->group;
+  enum intr_level old_level;
+
+  ASSERT (t == thread_current ());
+
+  old_level = intr_disable ();
+  t->group = NULL;
+  g->runnable_cnt--;
+  intr_set_level (old_level);
+
+  while (g != NULL)
+    {
+      struct stride_group *parent = g->parent;
+      bool dead;
+
+      old_level = intr_disable ();
+      dead = --g->ref_cnt == 0;
+      if (dead && parent != &root_group)
+        parent->tickets += g->tickets;
+      intr_set_level (old_level);
+
+      if (!dead)
+        break;
+      free (g);
+      g = parent;
+    }
+}
+
 /* Idle thread.  Executes when no other thread is ready to run.
 
    The idle thread is initially put on the ready list by
@@ -392,14 +1021,26 @@ idle (void *idle_started_ UNUSED)
 {
   struct semaphore *idle_started = idle_started_;
   idle_thread = thread_current ();
+  group_leave (idle_thread);
   sema_up (idle_started);
 
   for (;;) 
     {
+      /* Zero free pages in the background for as long as nothing
+         else is ready.  Interrupts don't preempt the idle thread
+         just because another thread becomes ready, so check for
+         that after each page. */
+      while (ready_empty () && palloc_zero_idle ())
+        continue;
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
 
+      /* Nothing else is ready, so there is no need to interrupt
+         at each tick until something is. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -463,14 +1104,24 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  t->nice = NICE_DEFAULT;
+  t->recent_cpu = fix_int (0);
+  t->decay_epoch = decay_epoch;
+  t->group = t == initial_thread ? &root_group : thread_current ()->group;
+  list_init (&t->locks);
+  t->waiting_lock = NULL;
   list_init (&t->children);
   t->wait_status = NULL;
   list_init (&t->fds);
+#ifdef VM
+  list_init (&t->mappings);
+#endif
   t->next_handle = 2;
   t->magic = THREAD_MAGIC;
 
   old_level = intr_disable ();
+  t->group->ref_cnt++;
   list_push_back (&all_list, &t->allelem);
   intr_set_level (old_level);
 }
@@ -488,18 +1139,159 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Returns true if no thread is ready to run, false otherwise.
+   Interrupts must be off, unless the caller is only polling. */
+static bool
+ready_empty (void) 
+{
+  return heap_empty (&rt_ready) && queues_empty ();
+}
+
+/* Returns true if no thread outside the real-time class is ready
+   to run, false otherwise.  Interrupts must be off, unless the
+   caller is only polling. */
+static bool
+queues_empty (void) 
+{
+  int i;
+
+  if (thread_stride)
+    return rb_empty (&stride_queue);
+  for (i = 0; i < READY_WORDS; i++)
+    if (ready_mask[i] != 0)
+      return false;
+  return true;
+}
+
+/* Returns the priority of the highest priority ready thread
+   outside the real-time class.  At least one such thread must be
+   ready.  Interrupts must be off. */
+static int
+ready_max_priority (void) 
+{
+  int i;
+
+  for (i = READY_WORDS - 1; i >= 0; i--)
+    if (ready_mask[i] != 0)
+      return PRI_MIN + i * 32 + (31 - __builtin_clz (ready_mask[i]));
+  NOT_REACHED ();
+}
+
+/* Adds T, which must be ready, to the real-time run queue if it
+   is an unthrottled real-time thread, or otherwise to the back of
+   the run queue for its priority, or to the stride run queue in
+   order of pass.  Interrupts must be off. */
+static void
+ready_push (struct thread *t) 
+{
+  int idx = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  if (rt_active (t))
+    {
+      heap_insert (&rt_ready, &t->rt_elem);
+      ready_cnt++;
+      return;
+    }
+
+  if (thread_stride)
+    {
+      if (t->pass < stride_vtime)
+        t->pass = stride_vtime;
+      rb_insert (&stride_queue, &t->stride_elem);
+      ready_cnt++;
+      return;
+    }
+  list_push_back (&ready_queues[idx], &t->elem);
+  ready_mask[idx / 32] |= 1u << (idx % 32);
+  ready_cnt++;
+}
+
+/* Removes T from its run queue.  Interrupts must be off. */
+static void
+ready_remove (struct thread *t) 
+{
+  int idx = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (rt_active (t))
+    {
+      heap_remove (&rt_ready, &t->rt_elem);
+      ready_cnt--;
+      return;
+    }
+  if (thread_stride)
+    {
+      rb_remove (&stride_queue, &t->stride_elem);
+      ready_cnt--;
+      return;
+    }
+  list_remove (&t->elem);
+  ready_cnt--;
+  if (list_empty (&ready_queues[idx]))
+    ready_mask[idx / 32] &= ~(1u << (idx % 32));
+}
+
+/* Sets T's priority, including donations, to PRIORITY, moving T
+   to the matching run queue if it is ready.  Interrupts must be
+   off. */
+static void
+set_priority (struct thread *t, int priority) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->status == THREAD_READY && !thread_stride)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else
+    t->priority = priority;
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   idle_thread.
+
+   The thread chosen is the one that has been waiting longest at
+   the highest priority, so that threads of equal priority take
+   turns, or under the stride scheduler the one with the lowest
+   pass.  Real-time threads come first, in order of deadline. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  struct thread *t;
+
+  if (ready_empty ())
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+  if (!heap_empty (&rt_ready))
+    {
+      t = heap_entry (heap_pop_min (&rt_ready), struct thread, rt_elem);
+      ready_cnt--;
+      return t;
+    }
+
+  if (thread_stride)
+    {
+      t = rb_entry (rb_pop_first (&stride_queue), struct thread,
+                    stride_elem);
+      ready_cnt--;
+      stride_vtime = t->pass;
+      return t;
+    }
+
+  t = list_entry (list_front (&ready_queues[ready_max_priority ()
+                                            - PRI_MIN]),
+                  struct thread, elem);
+  ready_remove (t);
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -527,10 +1319,15 @@ thread_schedule_tail (struct thread *prev)
 
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
+  fpu_switch (cur);
 
   /* Start new time slice. */
   thread_ticks = 0;
 
+  /* Restart the tick if the idle thread stopped it. */
+  if (prev != NULL && prev == idle_thread)
+    timer_idle_exit ();
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
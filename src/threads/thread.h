@@ -2,8 +2,13 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
+#include <heap.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
+#include <vmstats.h>
+#include "threads/fixed-point.h"
 #include "threads/synch.h"
 
 /* States in a thread's life cycle. */
@@ -24,6 +29,23 @@ typedef int tid_t;
 #define PRI_MIN 0                       /* Lowest priority. */
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1) /* Number of priorities. */
+
+/* Thread niceness, for the multi-level feedback queue scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
+/* Ticket groups, for the stride scheduler. */
+#define TICKETS_DEFAULT 100             /* Tickets of the initial group. */
+#define TICKETS_MAX 10000               /* Most tickets in one group. */
+
+/* Real-time reservations, for the earliest-deadline-first class.
+   Reserved CPU shares are in units of 1/RT_UTIL_SCALE, and all
+   reservations together may not exceed RT_UTIL_MAX, so that the
+   other classes always keep some of the CPU. */
+#define RT_UTIL_SCALE 1000000           /* Whole CPU. */
+#define RT_UTIL_MAX 900000              /* Most that can be reserved. */
 
 /* A kernel thread or user process.
 
@@ -88,7 +110,23 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Priority, including donations. */
+    int base_priority;                  /* Priority, without donations. */
+    int nice;                           /* Niceness. */
+    fixed_point_t recent_cpu;           /* Recent CPU use, in ticks. */
+    unsigned decay_epoch;               /* Last recent_cpu decay applied. */
+    struct stride_group *group;         /* Ticket group, for stride. */
+    int64_t pass;                       /* Virtual time, for stride. */
+    struct rb_elem stride_elem;         /* Element in stride run queue. */
+    int rt_period;                      /* Real-time period, or 0. */
+    int rt_budget;                      /* Ticks reserved per period. */
+    int rt_remaining;                   /* Ticks left this period. */
+    int rt_util;                        /* Reserved CPU share. */
+    int64_t rt_deadline;                /* End of this period. */
+    struct heap_elem rt_elem;           /* Real-time run or wait queue. */
+
+    /* Owned by threads/fpu.c. */
+    void *fpu;                          /* FPU state, or null if unused. */
     struct list_elem allelem;           /* List element for all threads list. */
 
     /* Owned by process.c. */
@@ -97,15 +135,31 @@ struct thread
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct list locks;                  /* Locks held, for donation. */
+    struct lock *waiting_lock;          /* Lock being acquired, or null. */
+
+    /* Owned by devices/timer.c. */
+    uint64_t wakeup_cycle;              /* Time-stamp counter to wake at. */
+    struct heap_elem sleep_elem;        /* Element in sleeping threads. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+#endif
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash *pages;                 /* Page table. */
+    void *user_esp;                     /* User's stack pointer. */
+    struct vmstats vmstats;             /* Page fault statistics. */
+    int64_t ws_tick;                    /* Next working set estimate. */
 #endif
     struct file *bin_file;              /* Executable. */
 
     /* Owned by syscall.c. */
     struct list fds;                    /* List of file descriptors. */
+#ifdef VM
+    struct list mappings;               /* Memory-mapped files. */
+#endif
     int next_handle;                    /* Next handle value. */
 
     /* Owned by thread.c. */
@@ -132,10 +186,16 @@ struct wait_status
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the stride scheduler, which divides the CPU
+   among ticket groups in proportion to their tickets.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_idle_ticks (int64_t);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -150,6 +210,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -157,10 +218,18 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *, int);
+void thread_update_priority (void);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+bool thread_set_tickets (int);
+bool thread_new_tenant (void);
+int thread_get_tickets (void);
+
+bool thread_set_realtime (int period, int budget);
+
 #endif /* threads/thread.h */
@@ -2,8 +2,13 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -45,8 +50,9 @@ exception_init (void)
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
   intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-  intr_register_int (7, 0, INTR_ON, kill,
-                     "#NM Device Not Available Exception");
+  if (!fpu_available ())
+    intr_register_int (7, 0, INTR_ON, kill,
+                       "#NM Device Not Available Exception");
   intr_register_int (11, 0, INTR_ON, kill, "#NP Segment Not Present");
   intr_register_int (12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
   intr_register_int (13, 0, INTR_ON, kill, "#GP General Protection Exception");
@@ -148,6 +154,18 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Allow the pager to try to handle it.  Faults in the kernel
+     come from system calls touching user memory, which may need
+     to be paged in or may grow the stack below the user stack
+     pointer saved on entry to the system call. */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+  if ((not_present || write) && is_user_vaddr (fault_addr)
+      && page_in (fault_addr, write))
+    return;
+#endif
+
   /* Handle bad dereferences from system call implementations. */
   if (!user) 
     {
@@ -16,8 +16,13 @@
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmd_line, void (**eip) (void), void **esp);
@@ -33,6 +38,31 @@ struct exec_info
     bool success;                       /* Program successfully loaded? */
   };
 
+/* Cache of wait_status structures. */
+static struct kmem_cache *wait_status_cache;
+
+/* Initializes wait_status CS_ as it is allocated, for a child
+   process referenced by both itself and its parent. */
+static void
+init_wait_status (void *cs_)
+{
+  struct wait_status *cs = cs_;
+
+  lock_init (&cs->lock);
+  cs->ref_cnt = 2;
+  cs->exit_code = -1;
+  sema_init (&cs->dead, 0);
+}
+
+/* Initializes the user process module. */
+void
+process_init (void)
+{
+  wait_status_cache = kmem_cache_create ("wait_status",
+                                         sizeof (struct wait_status),
+                                         init_wait_status);
+}
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -79,25 +109,20 @@ start_process (void *exec_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (exec->file_name, &if_.eip, &if_.esp);
+  success = (thread_new_tenant ()
+             && load (exec->file_name, &if_.eip, &if_.esp));
 
   /* Allocate wait_status. */
   if (success)
     {
       exec->wait_status = thread_current ()->wait_status
-        = malloc (sizeof *exec->wait_status);
+        = kmem_cache_alloc (wait_status_cache);
       success = exec->wait_status != NULL; 
     }
 
   /* Initialize wait_status. */
   if (success) 
-    {
-      lock_init (&exec->wait_status->lock);
-      exec->wait_status->ref_cnt = 2;
-      exec->wait_status->tid = thread_current ()->tid;
-      exec->wait_status->exit_code = -1;
-      sema_init (&exec->wait_status->dead, 0);
-    }
+    exec->wait_status->tid = thread_current ()->tid;
   
   /* Notify parent thread and clean up. */
   exec->success = success;
@@ -127,7 +152,7 @@ release_child (struct wait_status *cs)
   lock_release (&cs->lock);
 
   if (new_ref_cnt == 0)
-    free (cs);
+    kmem_cache_free (wait_status_cache, cs);
 }
 
 /* Waits for thread TID to die and returns its exit status.  If
@@ -167,6 +192,12 @@ process_exit (void)
   struct list_elem *e, *next;
   uint32_t *pd;
 
+#ifdef VM
+  /* Destroy the page hash table, which may refer to the
+     executable, before closing it. */
+  page_exit ();
+#endif
+
   /* Close executable (and allow writes). */
   file_close (cur->bin_file);
 
@@ -313,6 +344,14 @@ load (const char *cmd_line, void (**eip) (void), void **esp)
     goto done;
   process_activate ();
 
+#ifdef VM
+  /* Create page hash table. */
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    goto done;
+  hash_init (t->pages, page_hash, page_less, NULL);
+#endif
+
   /* Extract file_name from command line. */
   while (*cmd_line == ' ')
     cmd_line++;
@@ -321,7 +360,10 @@ load (const char *cmd_line, void (**eip) (void), void **esp)
   if (cp != NULL)
     *cp = '\0';
 
-  /* Open executable file. */
+  /* Open executable file.  fs_lock is held only while reading the
+     executable, not while setting up the stack, which may have to
+     evict a page and write it back to a file. */
+  lock_acquire (&fs_lock);
   t->bin_file = file = filesys_open (file_name);
   if (file == NULL) 
     {
@@ -402,6 +444,8 @@ load (const char *cmd_line, void (**eip) (void), void **esp)
         }
     }
 
+  lock_release (&fs_lock);
+
   /* Set up stack. */
   if (!setup_stack (cmd_line, esp))
     goto done;
@@ -413,12 +457,16 @@ load (const char *cmd_line, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
+  if (lock_held_by_current_thread (&fs_lock))
+    lock_release (&fs_lock);
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -487,7 +535,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifndef VM
   file_seek (file, ofs);
+#endif
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -496,6 +546,20 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where the page comes from; it is read in on the
+         first fault. */
+      struct page *p = page_allocate (upage, !writable);
+      if (p == NULL)
+        return false;
+      if (page_read_bytes > 0) 
+        {
+          p->file = file;
+          p->file_offset = ofs;
+          p->file_bytes = page_read_bytes;
+        }
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -515,6 +579,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -611,6 +676,24 @@ init_cmd_line (uint8_t *kpage, uint8_t *upage, const char *cmd_line,
 static bool
 setup_stack (const char *cmd_line, void **esp) 
 {
+#ifdef VM
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+  struct page *page = page_allocate (upage, false);
+  bool success = false;
+
+  if (page != NULL) 
+    {
+      page->frame = frame_alloc_and_lock (page);
+      if (page->frame != NULL)
+        {
+          memset (page->frame->base, 0, PGSIZE);
+          success = init_cmd_line (page->frame->base, upage, cmd_line,
+                                   esp);
+          frame_unlock (page->frame);
+        }
+    }
+  return success;
+#else
   uint8_t *kpage;
   bool success = false;
 
@@ -624,8 +707,10 @@ setup_stack (const char *cmd_line, void **esp)
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -645,3 +730,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
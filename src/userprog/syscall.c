@@ -11,8 +11,12 @@
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
  
  
 static int sys_halt (void);
@@ -28,18 +32,37 @@ static int sys_write (int handle, void *usrc_, unsigned size);
 static int sys_seek (int handle, unsigned position);
 static int sys_tell (int handle);
 static int sys_close (int handle);
+#ifdef VM
+static int sys_mmap (int handle, void *addr);
+static int sys_munmap (int mapping);
+static int sys_vmstats (struct vmstats *uprocess, struct vmstats *usystem);
+#endif
+static int sys_heapstats (struct heapstats *ustats,
+                          struct heap_tag_stats *utags, int tag_cnt);
+static int sys_tickets (int tickets);
+static int sys_realtime (int period, int budget);
  
 static void syscall_handler (struct intr_frame *);
 static void copy_in (void *, const void *, size_t);
+static void copy_out (void *, const void *, size_t);
  
-/* Serializes file system operations. */
-static struct lock fs_lock;
+/* A file descriptor, for binding a file handle to a file. */
+struct file_descriptor
+  {
+    struct list_elem elem;      /* List element. */
+    struct file *file;          /* File. */
+    int handle;                 /* File handle. */
+  };
+ 
+/* Cache of file descriptors. */
+static struct kmem_cache *fd_cache;
  
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  lock_init (&fs_lock);
+  fd_cache = kmem_cache_create ("file_descriptor",
+                                sizeof (struct file_descriptor), NULL);
 }
  
 /* System call handler. */
@@ -71,17 +94,33 @@ syscall_handler (struct intr_frame *f)
       {2, (syscall_function *) sys_seek},
       {1, (syscall_function *) sys_tell},
       {1, (syscall_function *) sys_close},
+#ifdef VM
+      {2, (syscall_function *) sys_mmap},
+      {1, (syscall_function *) sys_munmap},
+      [SYS_VMSTATS] = {2, (syscall_function *) sys_vmstats},
+#endif
+      [SYS_HEAPSTATS] = {3, (syscall_function *) sys_heapstats},
+      [SYS_TICKETS] = {1, (syscall_function *) sys_tickets},
+      [SYS_REALTIME] = {2, (syscall_function *) sys_realtime},
     };
 
   const struct syscall *sc;
   unsigned call_nr;
   int args[3];
 
+#ifdef VM
+  /* Save the user stack pointer, for stack growth on page faults
+     taken while accessing user memory on the process's behalf. */
+  thread_current ()->user_esp = f->esp;
+#endif
+
   /* Get the system call. */
   copy_in (&call_nr, f->esp, sizeof call_nr);
   if (call_nr >= sizeof syscall_table / sizeof *syscall_table)
     thread_exit ();
   sc = syscall_table + call_nr;
+  if (sc->func == NULL)
+    thread_exit ();
 
   /* Get the system call arguments. */
   ASSERT (sc->arg_cnt <= sizeof args / sizeof *args);
@@ -93,6 +132,7 @@ syscall_handler (struct intr_frame *f)
   f->eax = sc->func (args[0], args[1], args[2]);
 }
  
+#ifndef VM
 /* Returns true if UADDR is a valid, mapped user address,
    false otherwise. */
 static bool
@@ -101,6 +141,31 @@ verify_user (const void *uaddr)
   return (uaddr < PHYS_BASE
           && pagedir_get_page (thread_current ()->pagedir, uaddr) != NULL);
 }
+#endif
+
+/* Makes sure that the page containing user address UADDR is
+   valid and stays in memory until unlock_user() is called, so
+   that the file system can access it without faulting.  The
+   page must be writable if WILL_WRITE is true.
+   Returns true if successful, false otherwise. */
+static bool
+lock_user (const void *uaddr, bool will_write UNUSED) 
+{
+#ifdef VM
+  return page_lock (uaddr, will_write);
+#else
+  return verify_user (uaddr);
+#endif
+}
+
+/* Unlocks the page locked with lock_user(). */
+static void
+unlock_user (const void *uaddr UNUSED) 
+{
+#ifdef VM
+  page_unlock (uaddr);
+#endif
+}
  
 /* Copies a byte from user address USRC to kernel address DST.
    USRC must be below PHYS_BASE.
@@ -140,6 +205,20 @@ copy_in (void *dst_, const void *usrc_, size_t size)
       thread_exit ();
 }
  
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.
+   Call thread_exit() if any of the user accesses are invalid. */
+static void
+copy_out (void *udst_, const void *src_, size_t size) 
+{
+  uint8_t *udst = udst_;
+  const uint8_t *src = src_;
+
+  for (; size > 0; size--, udst++, src++) 
+    if (udst >= (uint8_t *) PHYS_BASE || !put_user (udst, *src))
+      thread_exit ();
+}
+ 
 /* Creates a copy of user string US in kernel memory
    and returns it as a page that must be freed with
    palloc_free_page().
@@ -193,9 +272,8 @@ sys_exec (const char *ufile)
   tid_t tid;
   char *kfile = copy_in_string (ufile);
  
-  lock_acquire (&fs_lock);
+  /* load() takes fs_lock itself. */
   tid = process_execute (kfile);
-  lock_release (&fs_lock);
  
   palloc_free_page (kfile);
  
@@ -241,14 +319,6 @@ sys_remove (const char *ufile)
   return ok;
 }
  
-/* A file descriptor, for binding a file handle to a file. */
-struct file_descriptor
-  {
-    struct list_elem elem;      /* List element. */
-    struct file *file;          /* File. */
-    int handle;                 /* File handle. */
-  };
- 
 /* Open system call. */
 static int
 sys_open (const char *ufile) 
@@ -257,7 +327,7 @@ sys_open (const char *ufile)
   struct file_descriptor *fd;
   int handle = -1;
  
-  fd = malloc (sizeof *fd);
+  fd = kmem_cache_alloc (fd_cache);
   if (fd != NULL)
     {
       lock_acquire (&fs_lock);
@@ -269,7 +339,7 @@ sys_open (const char *ufile)
           list_push_front (&cur->fds, &fd->elem);
         }
       else 
-        free (fd);
+        kmem_cache_free (fd_cache, fd);
       lock_release (&fs_lock);
     }
   
@@ -331,7 +401,6 @@ sys_read (int handle, void *udst_, unsigned size)
 
   /* Handle all other reads. */
   fd = lookup_fd (handle);
-  lock_acquire (&fs_lock);
   while (size > 0) 
     {
       /* How much to read into this page? */
@@ -339,15 +408,18 @@ sys_read (int handle, void *udst_, unsigned size)
       size_t read_amt = size < page_left ? size : page_left;
       off_t retval;
 
-      /* Check that touching this page is okay. */
-      if (!verify_user (udst)) 
-        {
-          lock_release (&fs_lock);
-          thread_exit ();
-        }
+      /* Check that touching this page is okay, and keep it in
+         memory while the file system writes to it.  This must
+         happen before acquiring fs_lock, since paging the page in
+         may need to read from a file. */
+      if (!lock_user (udst, true)) 
+        thread_exit ();
 
       /* Read from file into page. */
+      lock_acquire (&fs_lock);
       retval = file_read (fd->file, udst, read_amt);
+      lock_release (&fs_lock);
+      unlock_user (udst);
       if (retval < 0)
         {
           if (bytes_read == 0)
@@ -364,7 +436,6 @@ sys_read (int handle, void *udst_, unsigned size)
       udst += retval;
       size -= retval;
     }
-  lock_release (&fs_lock);
    
   return bytes_read;
 }
@@ -381,7 +452,6 @@ sys_write (int handle, void *usrc_, unsigned size)
   if (handle != STDOUT_FILENO)
     fd = lookup_fd (handle);
 
-  lock_acquire (&fs_lock);
   while (size > 0) 
     {
       /* How much bytes to write to this page? */
@@ -389,12 +459,10 @@ sys_write (int handle, void *usrc_, unsigned size)
       size_t write_amt = size < page_left ? size : page_left;
       off_t retval;
 
-      /* Check that we can touch this user page. */
-      if (!verify_user (usrc)) 
-        {
-          lock_release (&fs_lock);
-          thread_exit ();
-        }
+      /* Check that we can touch this user page, and keep it in
+         memory for the duration of the write. */
+      if (!lock_user (usrc, false)) 
+        thread_exit ();
 
       /* Do the write. */
       if (handle == STDOUT_FILENO)
@@ -403,7 +471,12 @@ sys_write (int handle, void *usrc_, unsigned size)
           retval = write_amt;
         }
       else
-        retval = file_write (fd->file, usrc, write_amt);
+        {
+          lock_acquire (&fs_lock);
+          retval = file_write (fd->file, usrc, write_amt);
+          lock_release (&fs_lock);
+        }
+      unlock_user (usrc);
       if (retval < 0) 
         {
           if (bytes_written == 0)
@@ -420,7 +493,6 @@ sys_write (int handle, void *usrc_, unsigned size)
       usrc += retval;
       size -= retval;
     }
-  lock_release (&fs_lock);
  
   return bytes_written;
 }
@@ -462,11 +534,189 @@ sys_close (int handle)
   file_close (fd->file);
   lock_release (&fs_lock);
   list_remove (&fd->elem);
-  free (fd);
+  kmem_cache_free (fd_cache, fd);
+  return 0;
+}
+ 
+#ifdef VM
+/* Binds a mapping id to a region of memory and a file. */
+struct mapping
+  {
+    struct list_elem elem;      /* List element. */
+    int handle;                 /* Mapping id. */
+    struct file *file;          /* File. */
+    uint8_t *base;              /* Start of memory mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+ 
+/* Tag for mappings. */
+static struct malloc_tag mapping_tag = MALLOC_TAG ("mapping");
+
+/* Returns the mapping associated with the given handle.
+   Terminates the process if HANDLE is not associated with a
+   memory mapping. */
+static struct mapping *
+lookup_mapping (int handle) 
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->handle == handle)
+        return m;
+    }
+
+  thread_exit ();
+}
+
+/* Removes mapping M from the virtual address space, writing
+   back any pages that have changed. */
+static void
+unmap (struct mapping *m) 
+{
+  size_t i;
+
+  list_remove (&m->elem);
+  for (i = 0; i < m->page_cnt; i++)
+    page_deallocate (m->base + PGSIZE * i);
+  lock_acquire (&fs_lock);
+  file_close (m->file);
+  lock_release (&fs_lock);
+  free_tagged (m, &mapping_tag);
+}
+
+/* Mmap system call.  The file's pages are read in on demand, as
+   they are touched, and written back when they are evicted or
+   unmapped. */
+static int
+sys_mmap (int handle, void *addr)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+  struct mapping *m;
+  off_t offset, length;
+
+  if (addr == NULL || pg_ofs (addr) != 0)
+    return -1;
+
+  m = malloc_tagged (sizeof *m, &mapping_tag);
+  if (m == NULL)
+    return -1;
+
+  /* Reopen the file, so that the mapping stays valid after the
+     file descriptor is closed. */
+  lock_acquire (&fs_lock);
+  m->file = file_reopen (fd->file);
+  length = m->file != NULL ? file_length (m->file) : 0;
+  if (length == 0 && m->file != NULL)
+    file_close (m->file);
+  lock_release (&fs_lock);
+  if (length == 0)
+    {
+      free_tagged (m, &mapping_tag);
+      return -1;
+    }
+  m->handle = thread_current ()->next_handle++;
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&thread_current ()->mappings, &m->elem);
+
+  for (offset = 0; offset < length; offset += PGSIZE)
+    {
+      uint8_t *upage = m->base + offset;
+      struct page *p;
+
+      if (!is_user_vaddr (upage)
+          || (p = page_allocate (upage, false)) == NULL)
+        {
+          unmap (m);
+          return -1;
+        }
+      p->private = false;
+      p->file = m->file;
+      p->file_offset = offset;
+      p->file_bytes = length - offset < PGSIZE ? length - offset : PGSIZE;
+      m->page_cnt++;
+    }
+
+  return m->handle;
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (int mapping) 
+{
+  unmap (lookup_mapping (mapping));
+  return 0;
+}
+
+/* Vmstats system call.  Either pointer may be null. */
+static int
+sys_vmstats (struct vmstats *uprocess, struct vmstats *usystem) 
+{
+  struct vmstats process, system;
+
+  page_get_stats (&process, &system);
+  if (uprocess != NULL)
+    copy_out (uprocess, &process, sizeof process);
+  if (usystem != NULL)
+    copy_out (usystem, &system, sizeof system);
   return 0;
 }
+#endif
+ 
+/* Heapstats system call.  Copies kernel heap and page allocator
+   statistics into USTATS, if it is nonnull, and statistics for
+   up to TAG_CNT allocation-site tags into UTAGS.  Returns the
+   number of tags, which may be more than TAG_CNT.  At most
+   HEAP_TAGS_MAX tags are copied, to bound kernel stack usage. */
+#define HEAP_TAGS_MAX 16
+static int
+sys_heapstats (struct heapstats *ustats, struct heap_tag_stats *utags,
+               int tag_cnt)
+{
+  struct heapstats stats;
+  struct heap_tag_stats tags[HEAP_TAGS_MAX];
+  size_t cnt, total;
+
+  if (ustats != NULL)
+    {
+      malloc_get_stats (&stats);
+      palloc_get_stats (&stats);
+      copy_out (ustats, &stats, sizeof stats);
+    }
+
+  cnt = tag_cnt < 0 || utags == NULL ? 0 : (size_t) tag_cnt;
+  if (cnt > HEAP_TAGS_MAX)
+    cnt = HEAP_TAGS_MAX;
+  total = malloc_get_tags (tags, cnt);
+  if (total < cnt)
+    cnt = total;
+  copy_out (utags, tags, cnt * sizeof *tags);
+  return total;
+}
+
+/* Tickets system call.  Moves the process into a new stride
+   scheduler group with TICKETS tickets, taken from its current
+   group, which its future children share. */
+static int
+sys_tickets (int tickets) 
+{
+  return thread_set_tickets (tickets);
+}
+
+/* Realtime system call.  Reserves BUDGET timer ticks out of
+   every PERIOD for the process, scheduled earliest deadline
+   first, or cancels the reservation if PERIOD is 0. */
+static int
+sys_realtime (int period, int budget) 
+{
+  return thread_set_realtime (period, budget);
+}
  
-/* On thread exit, close all open files. */
+/* On thread exit, close all open files and mapped files. */
 void
 syscall_exit (void) 
 {
@@ -481,6 +731,21 @@ syscall_exit (void)
       lock_acquire (&fs_lock);
       file_close (fd->file);
       lock_release (&fs_lock);
-      free (fd);
+      kmem_cache_free (fd_cache, fd);
+    }
+
+#ifdef VM
+  /* The pages of each mapping were already written back and
+     destroyed by process_exit(). */
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = next)
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      next = list_next (e);
+      lock_acquire (&fs_lock);
+      file_close (m->file);
+      lock_release (&fs_lock);
+      free_tagged (m, &mapping_tag);
     }
+#endif
 }
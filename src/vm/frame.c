@@ -0,0 +1,286 @@
+#include "vm/frame.h"
+#include <stdio.h>
+#include "vm/page.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+static struct frame *frames;
+static size_t frame_cnt;
+
+static struct lock scan_lock;
+static size_t hand;
+
+/* Initialize the frame manager. */
+void
+frame_init (void)
+{
+  void *base;
+
+  lock_init (&scan_lock);
+
+  frames = malloc (sizeof *frames * init_ram_pages);
+  if (frames == NULL)
+    PANIC ("out of memory allocating page frames");
+
+  while ((base = palloc_get_page (PAL_USER)) != NULL)
+    {
+      struct frame *f = &frames[frame_cnt++];
+      lock_init (&f->lock);
+      f->base = base;
+      f->page = NULL;
+      f->share = NULL;
+    }
+}
+
+/* Tries to lock frame F without sleeping.  Fails if F is locked
+   by another thread or by the current thread, which may already
+   hold the lock on the frame it is paging into. */
+static bool
+try_lock (struct frame *f)
+{
+  return (!lock_held_by_current_thread (&f->lock)
+          && lock_try_acquire (&f->lock));
+}
+
+/* Tries to find a free frame and lock it.  If one is found,
+   assigns it to PAGE and returns it.  Returns a null pointer if
+   there is no free frame.
+   Must be called with scan_lock held. */
+static struct frame *
+find_free_frame (struct page *page)
+{
+  size_t i;
+
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+      if (!try_lock (f))
+        continue;
+      if (f->page == NULL && f->share == NULL)
+        {
+          f->page = page;
+          return f;
+        }
+      lock_release (&f->lock);
+    }
+  return NULL;
+}
+
+/* Returns true if the data in locked frame F has been accessed
+   recently by any page that maps it, false otherwise. */
+static bool
+frame_accessed_recently (struct frame *f)
+{
+  if (f->share != NULL)
+    return share_accessed_recently (f->share);
+  else
+    return page_accessed_recently (f->page);
+}
+
+/* Advances the clock hand over up to MAX * 2 frames, collecting
+   up to MAX frames whose pages have not been accessed recently,
+   so that they can be evicted in a single swap cluster alongside
+   the frame already chosen for eviction.  Each victim frame is
+   locked and stored in VICTIMS.  Returns the number of victims.
+   Must be called with scan_lock held. */
+static size_t
+gather_victims (struct frame *victims[], size_t max)
+{
+  size_t cnt = 0;
+  size_t i;
+
+  for (i = 0; i < max * 2 && cnt < max; i++)
+    {
+      struct frame *f = &frames[hand];
+      if (++hand >= frame_cnt)
+        hand = 0;
+
+      if (!try_lock (f))
+        continue;
+      if ((f->page != NULL || f->share != NULL)
+          && !frame_accessed_recently (f))
+        victims[cnt++] = f;
+      else
+        lock_release (&f->lock);
+    }
+  return cnt;
+}
+
+/* Evicts the pages in the CNT frames in VICTIMS, which must be
+   locked, writing those that need it to swap in clusters of
+   consecutive slots.  Shared frames are simply unmapped.
+   VICTIMS[0] is reassigned to PAGE and returned still locked, or
+   a null pointer is returned if its page could not be evicted.
+   The remaining frames are freed if their pages were evicted,
+   and unlocked either way. */
+static struct frame *
+evict_frames (struct frame *victims[], size_t cnt, struct page *page)
+{
+  struct page *pages[SWAP_CLUSTER];
+  struct frame *f = victims[0];
+  size_t page_cnt = 0;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (victims[i]->share != NULL)
+      share_evict (victims[i]->share);
+    else
+      pages[page_cnt++] = victims[i]->page;
+  page_out_cluster (pages, page_cnt);
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct frame *v = victims[i];
+      if (v->page != NULL && v->page->frame == NULL)
+        v->page = NULL;
+      if (i > 0)
+        lock_release (&v->lock);
+    }
+
+  if (f->page != NULL)
+    {
+      lock_release (&f->lock);
+      return NULL;
+    }
+  f->page = page;
+  return f;
+}
+
+/* Tries to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+static struct frame *
+try_frame_alloc_and_lock (struct page *page)
+{
+  struct frame *f;
+  size_t i;
+
+  lock_acquire (&scan_lock);
+
+  /* Find a free frame. */
+  f = find_free_frame (page);
+  if (f != NULL)
+    {
+      lock_release (&scan_lock);
+      return f;
+    }
+
+  /* No free frame.  Find a frame to evict. */
+  for (i = 0; i < frame_cnt * 2; i++)
+    {
+      struct frame *victims[SWAP_CLUSTER];
+      size_t victim_cnt;
+
+      /* Get a frame. */
+      f = &frames[hand];
+      if (++hand >= frame_cnt)
+        hand = 0;
+
+      if (!try_lock (f))
+        continue;
+
+      if (f->page == NULL && f->share == NULL)
+        {
+          f->page = page;
+          lock_release (&scan_lock);
+          return f;
+        }
+
+      if (frame_accessed_recently (f))
+        {
+          lock_release (&f->lock);
+          continue;
+        }
+
+      /* Evict this frame, together with a batch of other idle
+         frames.  Writing them to swap as one cluster costs little
+         more than writing this frame alone, and leaves free
+         frames behind for the next few allocations. */
+      victims[0] = f;
+      victim_cnt = 1 + gather_victims (victims + 1, SWAP_CLUSTER - 1);
+      lock_release (&scan_lock);
+      return evict_frames (victims, victim_cnt, page);
+    }
+
+  lock_release (&scan_lock);
+  return NULL;
+}
+
+/* Tries really hard to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+struct frame *
+frame_alloc_and_lock (struct page *page)
+{
+  size_t try;
+
+  for (try = 0; try < 3; try++)
+    {
+      struct frame *f = try_frame_alloc_and_lock (page);
+      if (f != NULL)
+        {
+          ASSERT (lock_held_by_current_thread (&f->lock));
+          return f;
+        }
+      timer_msleep (1000);
+    }
+
+  return NULL;
+}
+
+/* Allocates and locks a frame for PAGE only if one is free,
+   without evicting anything.  Used for speculative page-ins.
+   Returns the frame if successful, a null pointer otherwise. */
+struct frame *
+frame_alloc_free_and_lock (struct page *page)
+{
+  struct frame *f;
+
+  lock_acquire (&scan_lock);
+  f = find_free_frame (page);
+  lock_release (&scan_lock);
+  return f;
+}
+
+/* Locks P's frame into memory, if it has one.
+   Upon return, p->frame will not change until P is unlocked. */
+void
+frame_lock (struct page *p)
+{
+  /* A frame can be asynchronously removed, but never inserted. */
+  struct frame *f = p->frame;
+  if (f != NULL)
+    {
+      lock_acquire (&f->lock);
+      if (f != p->frame)
+        {
+          lock_release (&f->lock);
+          ASSERT (p->frame == NULL);
+        }
+    }
+}
+
+/* Releases frame F for use by another page.
+   F must be locked for use by the current process.
+   Any data in F is lost. */
+void
+frame_free (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  f->page = NULL;
+  lock_release (&f->lock);
+}
+
+/* Unlocks frame F, allowing it to be evicted.
+   F must be locked for use by the current process. */
+void
+frame_unlock (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  lock_release (&f->lock);
+}
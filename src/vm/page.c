@@ -0,0 +1,626 @@
+#include "vm/page.h"
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/share.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "threads/vaddr.h"
+
+/* Maximum size of process stack, in bytes. */
+#define STACK_MAX (1024 * 1024)
+
+/* Interval between working set estimates, in timer ticks. */
+#define WS_INTERVAL TIMER_FREQ
+
+/* -vmstats: Print each process's statistics when it exits? */
+bool page_exit_stats;
+
+/* Statistics for the whole system.  Updated with interrupts
+   disabled, since any process may fault at any time. */
+static struct vmstats system_stats;
+
+/* Tag for page structures. */
+static struct malloc_tag page_tag = MALLOC_TAG ("page");
+
+/* Prints statistics S, labeled with NAME. */
+static void
+print_stats (const char *name, const struct vmstats *s)
+{
+  printf ("%s: %llu minor and %llu major page faults, "
+          "%llu file-backed, %llu anonymous, %llu bad\n",
+          name, s->minor_faults, s->major_faults,
+          s->file_faults, s->anon_faults, s->bad_faults);
+  printf ("%s: %llu cycles in page faults, working set %u pages\n",
+          name, s->fault_cycles, s->working_set);
+}
+
+/* Returns true if page P, which must have a frame, is part of a
+   memory-mapped file and has been modified, so that it must be
+   written back to the file before its frame is reused. */
+static bool
+needs_write_back (struct page *p)
+{
+  return (p->file != NULL && !p->private
+          && pagedir_is_dirty (p->thread->pagedir, p->addr));
+}
+
+/* Writes page P, which must have a locked frame, back to its
+   file. */
+static void
+write_back (struct page *p)
+{
+  lock_acquire (&fs_lock);
+  file_write_at (p->file, p->frame->base, p->file_bytes, p->file_offset);
+  lock_release (&fs_lock);
+}
+
+/* Unmaps page P and releases its frame, if it has one, along
+   with its swap slot, if it has one.  A modified page of a
+   memory-mapped file is first written back to the file. */
+static void
+release_page (struct page *p)
+{
+  frame_lock (p);
+  if (p->frame)
+    {
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      if (p->frame->share != NULL)
+        share_detach (p);
+      else
+        {
+          if (needs_write_back (p))
+            write_back (p);
+          frame_free (p->frame);
+        }
+    }
+  swap_discard (p);
+  zswap_discard (p);
+}
+
+/* Destroys a page, which must be in the current process's
+   page table.  Used as a callback for hash_destroy(). */
+static void
+destroy_page (struct hash_elem *p_, void *aux UNUSED)
+{
+  struct page *p = hash_entry (p_, struct page, hash_elem);
+  release_page (p);
+  free_tagged (p, &page_tag);
+}
+
+/* Destroys the current process's page table. */
+void
+page_exit (void)
+{
+  struct thread *t = thread_current ();
+  struct hash *h = t->pages;
+  if (h != NULL)
+    {
+      enum intr_level old_level;
+
+      if (page_exit_stats)
+        print_stats (t->name, &t->vmstats);
+      old_level = intr_disable ();
+      system_stats.working_set -= t->vmstats.working_set;
+      intr_set_level (old_level);
+
+      t->pages = NULL;
+      hash_destroy (h, destroy_page);
+      free (h);
+    }
+}
+
+/* Returns the page containing the given virtual ADDRESS,
+   or a null pointer if no such page exists.
+   Allocates stack pages as necessary. */
+static struct page *
+page_for_addr (const void *address)
+{
+  if (address < PHYS_BASE)
+    {
+      struct page p;
+      struct hash_elem *e;
+
+      /* Find existing page. */
+      p.addr = (void *) pg_round_down (address);
+      e = hash_find (thread_current ()->pages, &p.hash_elem);
+      if (e != NULL)
+        return hash_entry (e, struct page, hash_elem);
+
+      /* No page.  Expand stack? */
+      if (p.addr > PHYS_BASE - STACK_MAX
+          && (uint8_t *) thread_current ()->user_esp - 32
+             <= (uint8_t *) address)
+        return page_allocate (p.addr, false);
+    }
+
+  return NULL;
+}
+
+/* Reads swapped-out page P into its frame, which must be locked,
+   along with as many of its swap neighbors as fit in free
+   frames.  The neighbors are mapped into the page table so that
+   the process does not fault on them; because they have not
+   been accessed, they are the first to be evicted again if the
+   guess was wrong. */
+static void
+swap_in_with_readahead (struct page *p)
+{
+  struct page *pages[SWAP_CLUSTER];
+  size_t cnt, idx, first, last;
+  size_t i;
+
+  cnt = swap_neighbors (p, pages, SWAP_CLUSTER, &idx);
+
+  /* Find frames for the neighbors, trimming the run at the first
+     neighbor on either side that does not get one. */
+  for (last = idx + 1; last < cnt; last++)
+    {
+      pages[last]->frame = frame_alloc_free_and_lock (pages[last]);
+      if (pages[last]->frame == NULL)
+        break;
+    }
+  for (first = idx; first > 0; first--)
+    {
+      struct page *q = pages[first - 1];
+      q->frame = frame_alloc_free_and_lock (q);
+      if (q->frame == NULL)
+        break;
+    }
+
+  swap_in_cluster (pages + first, last - first);
+
+  for (i = first; i < last; i++)
+    {
+      struct page *q = pages[i];
+      if (q == p)
+        continue;
+      pagedir_set_page (q->thread->pagedir, q->addr, q->frame->base,
+                        !q->read_only);
+      frame_unlock (q->frame);
+    }
+}
+
+/* Returns true if page P's data may be shared with other pages
+   that have the same data: it must not have been modified yet,
+   and must either be read from an executable, rather than
+   written back to a file, or be all zeros. */
+static bool
+is_shareable (const struct page *p)
+{
+  return (p->sector == (block_sector_t) -1 && p->zdata == NULL
+          && (p->file == NULL || p->read_only || p->private));
+}
+
+/* Locks a frame for page P and pages it in.  Sets *MAJOR to
+   true if that required reading from disk.
+   Returns true if successful, false on failure. */
+static bool
+do_page_in (struct page *p, bool *major)
+{
+  /* Use a frame that already has the data, if possible. */
+  if (is_shareable (p) && share_page_in (p))
+    return true;
+
+  /* Get a frame for the page. */
+  p->frame = frame_alloc_and_lock (p);
+  if (p->frame == NULL)
+    return false;
+
+  /* Copy data into the frame. */
+  if (p->zdata != NULL)
+    {
+      /* Get data from compressed swap. */
+      zswap_in (p);
+    }
+  else if (p->sector != (block_sector_t) -1)
+    {
+      /* Get data from swap. */
+      swap_in_with_readahead (p);
+      *major = true;
+    }
+  else if (p->file != NULL)
+    {
+      /* Get data from file. */
+      off_t read_bytes;
+
+      lock_acquire (&fs_lock);
+      read_bytes = file_read_at (p->file, p->frame->base,
+                                 p->file_bytes, p->file_offset);
+      lock_release (&fs_lock);
+      *major = true;
+      memset ((uint8_t *) p->frame->base + read_bytes, 0,
+              PGSIZE - read_bytes);
+      if (read_bytes != p->file_bytes)
+        printf ("bytes read (%"PROTd") != bytes requested (%"PROTd")\n",
+                read_bytes, p->file_bytes);
+      if (is_shareable (p))
+        share_attach (p);
+    }
+  else
+    {
+      /* Provide all-zero page. */
+      memset (p->frame->base, 0, PGSIZE);
+      share_attach (p);
+    }
+
+  return true;
+}
+
+/* Gives page P, whose shared frame it has locked, a private
+   copy of the data, so that it can be written.  The copy no
+   longer corresponds to the file, so it goes to swap if it is
+   evicted.  Returns true if successful, with the new frame
+   locked, or false on failure, with the shared frame still
+   locked. */
+static bool
+unshare_page (struct page *p)
+{
+  struct frame *shared = p->frame;
+  struct frame *copy;
+
+  ASSERT (shared->share != NULL);
+
+  /* The shared frame stays locked, so it cannot be chosen for
+     eviction to make room for its own copy. */
+  copy = frame_alloc_and_lock (p);
+  if (copy == NULL)
+    return false;
+  memcpy (copy->base, shared->base, PGSIZE);
+
+  pagedir_clear_page (p->thread->pagedir, p->addr);
+  share_detach (p);
+  p->frame = copy;
+  p->file = NULL;
+  p->file_offset = 0;
+  p->file_bytes = 0;
+  return true;
+}
+
+/* Makes sure that page P, which must have a locked frame, is
+   mapped into its page table, and that the mapping is writable
+   if WRITE is true.  Shared frames are mapped read-only, so a
+   write to one faults and gets its own copy.  Returns true if
+   successful, false on failure. */
+static bool
+map_page (struct page *p, bool write)
+{
+  uint32_t *pd = p->thread->pagedir;
+
+  if (write && p->frame->share != NULL && !unshare_page (p))
+    return false;
+  return (pagedir_get_page (pd, p->addr) != NULL
+          || pagedir_set_page (pd, p->addr, p->frame->base,
+                               !p->read_only && p->frame->share == NULL));
+}
+
+/* Estimates the current process's working set as the number of
+   its resident pages accessed since the last estimate, and
+   schedules the next estimate.  The accessed bits are cleared
+   to start the next interval, but remembered in each page's
+   `referenced' flag so that page replacement still sees them. */
+static void
+estimate_working_set (void)
+{
+  struct thread *t = thread_current ();
+  struct hash_iterator i;
+  enum intr_level old_level;
+  unsigned cnt = 0;
+
+  hash_first (&i, t->pages);
+  while (hash_next (&i))
+    {
+      struct page *p = hash_entry (hash_cur (&i), struct page, hash_elem);
+
+      frame_lock (p);
+      if (p->frame != NULL)
+        {
+          if (pagedir_is_accessed (t->pagedir, p->addr))
+            {
+              pagedir_set_accessed (t->pagedir, p->addr, false);
+              p->referenced = true;
+              cnt++;
+            }
+          frame_unlock (p->frame);
+        }
+    }
+
+  old_level = intr_disable ();
+  system_stats.working_set += cnt - t->vmstats.working_set;
+  intr_set_level (old_level);
+  t->vmstats.working_set = cnt;
+  t->ws_tick = timer_ticks () + WS_INTERVAL;
+}
+
+/* Adds a page fault to statistics S.  SUCCESS, MAJOR, and FILE
+   tell whether it was resolved, whether that took disk I/O, and
+   whether the page was file-backed.  CYCLES is the time taken. */
+static void
+count_fault (struct vmstats *s, bool success, bool major, bool file,
+             uint64_t cycles)
+{
+  if (!success)
+    s->bad_faults++;
+  else
+    {
+      if (major)
+        s->major_faults++;
+      else
+        s->minor_faults++;
+      if (file)
+        s->file_faults++;
+      else
+        s->anon_faults++;
+    }
+  s->fault_cycles += cycles;
+}
+
+/* Faults in the page containing FAULT_ADDR.  WRITE is true if
+   the fault was caused by a write.
+   Returns true if successful, false on failure. */
+bool
+page_in (void *fault_addr, bool write)
+{
+  struct thread *t = thread_current ();
+  uint64_t start = timer_cycles ();
+  uint64_t cycles;
+  enum intr_level old_level;
+  struct page *p;
+  bool success = false;
+  bool major = false;
+  bool file = false;
+
+  /* Can't handle page faults without a hash table. */
+  if (t->pages == NULL)
+    return false;
+
+  if (timer_ticks () >= t->ws_tick)
+    estimate_working_set ();
+
+  p = page_for_addr (fault_addr);
+  if (p != NULL && !(p->read_only && write))
+    {
+      file = p->file != NULL;
+      frame_lock (p);
+      if (p->frame != NULL || do_page_in (p, &major))
+        {
+          ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+          /* Install frame into page table. */
+          success = map_page (p, write);
+
+          /* Release frame. */
+          frame_unlock (p->frame);
+        }
+    }
+
+  cycles = timer_cycles () - start;
+  count_fault (&t->vmstats, success, major, file, cycles);
+  old_level = intr_disable ();
+  count_fault (&system_stats, success, major, file, cycles);
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Evicts page P.
+   P must have a locked frame.
+   Return true if successful, false on failure. */
+bool
+page_out (struct page *p)
+{
+  page_out_cluster (&p, 1);
+  return p->frame == NULL;
+}
+
+/* Evicts the CNT pages in PAGES, each of which must have a
+   locked frame.  Pages whose contents can be recovered from
+   their files are simply dropped, and modified pages of
+   memory-mapped files are written back to their files; the rest
+   are compressed into memory or, failing that, written to swap
+   together, in as few transfers as possible.  A page that was
+   evicted successfully has its frame pointer cleared; a page
+   that could not be evicted keeps its frame. */
+void
+page_out_cluster (struct page *pages[], size_t cnt)
+{
+  struct page *swap_pages[SWAP_CLUSTER];
+  size_t swap_cnt = 0;
+  size_t i;
+
+  ASSERT (cnt <= SWAP_CLUSTER);
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = pages[i];
+      bool dirty;
+
+      ASSERT (p->frame != NULL);
+      ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+      /* Mark page not present in page table, forcing accesses by
+         the process to fault.  This must happen before checking
+         the dirty bit, to prevent a race with the process dirtying
+         the page. */
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+
+      /* Has the frame been modified? */
+      dirty = pagedir_is_dirty (p->thread->pagedir, p->addr);
+
+      /* An unmodified page with a file behind it can be re-read
+         from the file later, and a memory-mapped page can be
+         written back to its file.  Anything else goes to swap,
+         compressed in memory if possible. */
+      if (p->file != NULL && !dirty)
+        p->frame = NULL;
+      else if (p->file != NULL && !p->private)
+        {
+          write_back (p);
+          p->frame = NULL;
+        }
+      else if (zswap_out (p))
+        p->frame = NULL;
+      else
+        swap_pages[swap_cnt++] = p;
+    }
+
+  swap_cnt = swap_out_cluster (swap_pages, swap_cnt);
+  for (i = 0; i < swap_cnt; i++)
+    swap_pages[i]->frame = NULL;
+}
+
+/* Returns true if page P's data has been accessed recently,
+   false otherwise.
+   P must have a frame locked into memory. */
+bool
+page_accessed_recently (struct page *p)
+{
+  bool was_accessed;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  was_accessed = p->referenced;
+  p->referenced = false;
+  if (pagedir_is_accessed (p->thread->pagedir, p->addr))
+    {
+      pagedir_set_accessed (p->thread->pagedir, p->addr, false);
+      was_accessed = true;
+    }
+  return was_accessed;
+}
+
+/* Adds a mapping for user virtual address VADDR to the page hash
+   table.  Fails if VADDR is already mapped or if memory
+   allocation fails. */
+struct page *
+page_allocate (void *vaddr, bool read_only)
+{
+  struct thread *t = thread_current ();
+  struct page *p = malloc_tagged (sizeof *p, &page_tag);
+  if (p != NULL)
+    {
+      p->addr = pg_round_down (vaddr);
+
+      p->read_only = read_only;
+      p->private = !read_only;
+
+      p->frame = NULL;
+      p->referenced = false;
+
+      p->sector = (block_sector_t) -1;
+      p->zdata = NULL;
+      p->zsize = 0;
+
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+
+      p->thread = thread_current ();
+
+      if (hash_insert (t->pages, &p->hash_elem) != NULL)
+        {
+          /* Already mapped. */
+          free_tagged (p, &page_tag);
+          p = NULL;
+        }
+    }
+  return p;
+}
+
+/* Evicts the page containing address VADDR
+   and removes it from the page table. */
+void
+page_deallocate (void *vaddr)
+{
+  struct page *p = page_for_addr (vaddr);
+  ASSERT (p != NULL);
+  release_page (p);
+  hash_delete (thread_current ()->pages, &p->hash_elem);
+  free_tagged (p, &page_tag);
+}
+
+/* Stores the current process's statistics into *PROCESS and the
+   whole system's into *SYSTEM. */
+void
+page_get_stats (struct vmstats *process, struct vmstats *system)
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+
+  if (t->pages != NULL && timer_ticks () >= t->ws_tick)
+    estimate_working_set ();
+  *process = t->vmstats;
+
+  old_level = intr_disable ();
+  *system = system_stats;
+  intr_set_level (old_level);
+}
+
+/* Prints statistics for the whole system. */
+void
+page_print_stats (void)
+{
+  print_stats ("Paging", &system_stats);
+}
+
+/* Returns a hash value for the page that E refers to. */
+unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return ((uintptr_t) p->addr) >> PGBITS;
+}
+
+/* Returns true if page A precedes page B. */
+bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->addr < b->addr;
+}
+
+/* Tries to lock the page containing ADDR into physical memory.
+   If WILL_WRITE is true, the page must be writeable;
+   otherwise it may be read-only.
+   Returns true if successful, false on failure. */
+bool
+page_lock (const void *addr, bool will_write)
+{
+  struct page *p = page_for_addr (addr);
+  bool major;
+
+  if (p == NULL || (p->read_only && will_write))
+    return false;
+
+  frame_lock (p);
+  if (p->frame == NULL && !do_page_in (p, &major))
+    return false;
+
+  /* Make sure the page is mapped, so that the kernel does not
+     fault on it while holding the frame lock. */
+  if (!map_page (p, will_write))
+    {
+      frame_unlock (p->frame);
+      return false;
+    }
+  return true;
+}
+
+/* Unlocks a page locked with page_lock(). */
+void
+page_unlock (const void *addr)
+{
+  struct page *p = page_for_addr (addr);
+  ASSERT (p != NULL);
+  frame_unlock (p->frame);
+}
@@ -0,0 +1,62 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <vmstats.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+/* Virtual page. */
+struct page 
+  {
+    /* Immutable members. */
+    void *addr;                 /* User virtual address. */
+    bool read_only;             /* Read-only page? */
+    struct thread *thread;      /* Owning thread. */
+
+    /* Accessed only in owning process context. */
+    struct hash_elem hash_elem; /* struct thread `pages' hash element. */
+
+    /* Set only in owning process context with frame->lock held.
+       Cleared only with frame->lock held. */
+    struct frame *frame;        /* Page frame. */
+    struct list_elem share_elem; /* struct share `pages' element. */
+    bool referenced;            /* Accessed bit saved by working set scan. */
+
+    /* Swap information, protected by frame->lock. */
+    block_sector_t sector;      /* Starting sector of swap area, or -1. */
+    void *zdata;                /* Compressed data in memory, or null. */
+    size_t zsize;               /* Size of compressed data in bytes. */
+    
+    /* Memory-mapped file information, protected by frame->lock. */
+    bool private;               /* False to write back to file,
+                                   true to write back to swap. */
+    struct file *file;          /* File. */
+    off_t file_offset;          /* Offset in file. */
+    off_t file_bytes;           /* Bytes to read/write, 1...PGSIZE. */
+  };
+
+extern bool page_exit_stats;
+
+void page_exit (void);
+
+struct page *page_allocate (void *, bool read_only);
+void page_deallocate (void *vaddr);
+
+bool page_in (void *fault_addr, bool write);
+bool page_out (struct page *);
+void page_out_cluster (struct page *[], size_t cnt);
+bool page_accessed_recently (struct page *);
+
+bool page_lock (const void *, bool will_write);
+void page_unlock (const void *);
+
+void page_get_stats (struct vmstats *process, struct vmstats *system);
+void page_print_stats (void);
+
+hash_hash_func page_hash;
+hash_less_func page_less;
+
+#endif /* vm/page.h */
@@ -0,0 +1,227 @@
+#include "vm/share.h"
+#include <debug.h>
+#include <stdint.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+
+/* Shared frames, keyed by file contents.
+   A frame can be found here only while it is shared. */
+static struct hash shares;
+
+/* Protects `shares'.  Never acquired before a frame lock, so
+   that a thread holding a frame lock may acquire it. */
+static struct lock share_lock;
+
+/* Tag for share structures. */
+static struct malloc_tag share_tag = MALLOC_TAG ("share");
+
+static hash_hash_func share_hash;
+static hash_less_func share_less;
+
+/* Initializes the share table. */
+void
+share_init (void)
+{
+  hash_init (&shares, share_hash, share_less, NULL);
+  lock_init (&share_lock);
+}
+
+/* Sets the key in S to identify the data of page P.  All pages
+   without a file have the same key, so that they share a single
+   zero-filled frame. */
+static void
+set_key (struct share *s, const struct page *p)
+{
+  s->inode = p->file != NULL ? file_get_inode (p->file) : NULL;
+  s->offset = p->file_offset;
+  s->bytes = p->file_bytes;
+}
+
+/* Returns true if A and B have the same key, false otherwise. */
+static bool
+same_key (const struct share *a, const struct share *b)
+{
+  return (a->inode == b->inode
+          && a->offset == b->offset
+          && a->bytes == b->bytes);
+}
+
+/* Removes S from the share table, if it is there, and frees it. */
+static void
+destroy_share (struct share *s)
+{
+  if (s->in_table)
+    {
+      lock_acquire (&share_lock);
+      hash_delete (&shares, &s->hash_elem);
+      lock_release (&share_lock);
+    }
+  free_tagged (s, &share_tag);
+}
+
+/* Tries to find a frame already holding the data of page P,
+   which must not have a frame.  If one is found, attaches P to
+   it, locks it, and returns true.  Returns false otherwise.
+   The frame may be mapped only read-only into P's page table. */
+bool
+share_page_in (struct page *p)
+{
+  struct share key;
+  struct hash_elem *e;
+  struct frame *f = NULL;
+
+  ASSERT (p->frame == NULL);
+
+  set_key (&key, p);
+  lock_acquire (&share_lock);
+  e = hash_find (&shares, &key.hash_elem);
+  if (e != NULL)
+    f = hash_entry (e, struct share, hash_elem)->frame;
+  lock_release (&share_lock);
+  if (f == NULL)
+    return false;
+
+  /* The frame may have been evicted, and even reused, since we
+     released share_lock, so check again with it locked. */
+  lock_acquire (&f->lock);
+  if (f->share == NULL || !same_key (f->share, &key))
+    {
+      lock_release (&f->lock);
+      return false;
+    }
+  list_push_back (&f->share->pages, &p->share_elem);
+  p->frame = f;
+  return true;
+}
+
+/* Makes the frame of page P, which P must have locked and which
+   must have just been filled from P's file or zeroed, available
+   to other pages with the same data.  If memory is short, leaves
+   the frame private to P. */
+void
+share_attach (struct page *p)
+{
+  struct frame *f = p->frame;
+  struct share *s;
+
+  ASSERT (f != NULL && f->page == p);
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  s = malloc_tagged (sizeof *s, &share_tag);
+  if (s == NULL)
+    return;
+  set_key (s, p);
+  s->frame = f;
+  list_init (&s->pages);
+  list_push_back (&s->pages, &p->share_elem);
+  f->page = NULL;
+  f->share = s;
+
+  /* If another process read the same data at the same time, the
+     table already has an entry, and this frame stays out of it. */
+  lock_acquire (&share_lock);
+  s->in_table = hash_insert (&shares, &s->hash_elem) == NULL;
+  lock_release (&share_lock);
+}
+
+/* Detaches page P from its shared frame, which P must have
+   locked and which must no longer be mapped in P's page table.
+   Unlocks the frame, freeing it if P was its last page. */
+void
+share_detach (struct page *p)
+{
+  struct frame *f = p->frame;
+  struct share *s = f->share;
+
+  ASSERT (s != NULL);
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  list_remove (&p->share_elem);
+  p->frame = NULL;
+  if (list_empty (&s->pages))
+    {
+      f->share = NULL;
+      destroy_share (s);
+      frame_free (f);
+    }
+  else
+    frame_unlock (f);
+}
+
+/* Returns true if any page mapping S's frame has been accessed
+   recently, false otherwise, and clears their accessed bits.
+   The frame must be locked. */
+bool
+share_accessed_recently (struct share *s)
+{
+  bool was_accessed = false;
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&s->frame->lock));
+
+  for (e = list_begin (&s->pages); e != list_end (&s->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, share_elem);
+      if (page_accessed_recently (p))
+        was_accessed = true;
+    }
+  return was_accessed;
+}
+
+/* Unmaps S's frame from every page that maps it and frees S.
+   The data need not be written anywhere, since it can be read
+   from the file again, or is all zeros.  The frame must be
+   locked; it is left locked but no longer in use. */
+void
+share_evict (struct share *s)
+{
+  struct frame *f = s->frame;
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  for (e = list_begin (&s->pages); e != list_end (&s->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, share_elem);
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      p->frame = NULL;
+    }
+  f->share = NULL;
+  destroy_share (s);
+}
+
+/* Returns a hash value for the share that E refers to. */
+static unsigned
+share_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct share *s = hash_entry (e, struct share, hash_elem);
+  uintptr_t key[3];
+
+  key[0] = (uintptr_t) s->inode;
+  key[1] = s->offset;
+  key[2] = s->bytes;
+  return hash_bytes (key, sizeof key);
+}
+
+/* Returns true if share A precedes share B. */
+static bool
+share_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct share *a = hash_entry (a_, struct share, hash_elem);
+  const struct share *b = hash_entry (b_, struct share, hash_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  else if (a->offset != b->offset)
+    return a->offset < b->offset;
+  else
+    return a->bytes < b->bytes;
+}
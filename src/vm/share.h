@@ -0,0 +1,40 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct frame;
+struct page;
+
+/* A frame shared read-only among pages, possibly of different
+   processes, whose contents come from the same part of the same
+   executable file, or which are all zeros.  Protected by the
+   frame's lock, except for hash_elem, which is protected by the
+   share table's lock. */
+struct share
+  {
+    struct hash_elem hash_elem; /* Share table element. */
+    bool in_table;              /* Is hash_elem in the share table? */
+
+    /* Key. */
+    struct inode *inode;        /* File's inode, or null if zeros. */
+    off_t offset;               /* Offset in file. */
+    off_t bytes;                /* Bytes read from file; rest are zero. */
+
+    struct frame *frame;        /* Frame holding the data. */
+    struct list pages;          /* Pages mapping the frame. */
+  };
+
+void share_init (void);
+
+bool share_page_in (struct page *);
+void share_attach (struct page *);
+void share_detach (struct page *);
+
+bool share_accessed_recently (struct share *);
+void share_evict (struct share *);
+
+#endif /* vm/share.h */
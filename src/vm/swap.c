@@ -0,0 +1,233 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* The swap device. */
+static struct block *swap_device;
+
+/* Used swap pages. */
+static struct bitmap *swap_bitmap;
+
+/* Page occupying each used swap slot, for finding the neighbors
+   of a page being swapped in. */
+static struct page **swap_owners;
+
+/* Protects swap_bitmap and swap_owners. */
+static struct lock swap_lock;
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Sets up swap. */
+void
+swap_init (void)
+{
+  size_t slot_cnt = 0;
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    printf ("no swap device--swap disabled\n");
+  else
+    slot_cnt = block_size (swap_device) / PAGE_SECTORS;
+
+  swap_bitmap = bitmap_create (slot_cnt);
+  if (swap_bitmap == NULL)
+    PANIC ("couldn't create swap bitmap");
+  if (slot_cnt > 0)
+    {
+      swap_owners = calloc (slot_cnt, sizeof *swap_owners);
+      if (swap_owners == NULL)
+        PANIC ("couldn't create swap owner table");
+    }
+  lock_init (&swap_lock);
+}
+
+/* Reads or writes the CNT pages in PAGES, which must occupy
+   consecutive swap slots starting at PAGES[0]'s, to or from
+   their frames, using a single multi-sector transfer. */
+static void
+transfer_cluster (struct page *pages[], size_t cnt, bool write)
+{
+  void *sectors[SWAP_CLUSTER * PAGE_SECTORS];
+  size_t i, j;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+  for (i = 0; i < cnt; i++)
+    {
+      ASSERT (pages[i]->frame != NULL);
+      ASSERT (lock_held_by_current_thread (&pages[i]->frame->lock));
+      ASSERT (pages[i]->sector == pages[0]->sector + i * PAGE_SECTORS);
+      for (j = 0; j < PAGE_SECTORS; j++)
+        sectors[i * PAGE_SECTORS + j] = ((uint8_t *) pages[i]->frame->base
+                                         + j * BLOCK_SECTOR_SIZE);
+    }
+
+  if (write)
+    block_write_multiple (swap_device, pages[0]->sector,
+                          cnt * PAGE_SECTORS, sectors);
+  else
+    block_read_multiple (swap_device, pages[0]->sector,
+                         cnt * PAGE_SECTORS, sectors);
+}
+
+/* Swaps in page P, which must have a locked frame
+   (and be swapped out). */
+void
+swap_in (struct page *p)
+{
+  swap_in_cluster (&p, 1);
+}
+
+/* Swaps in the CNT pages in PAGES, which must occupy consecutive
+   swap slots in order (see swap_neighbors()) and each have a
+   locked frame, with a single transfer. */
+void
+swap_in_cluster (struct page *pages[], size_t cnt)
+{
+  size_t slot = pages[0]->sector / PAGE_SECTORS;
+  size_t i;
+
+  transfer_cluster (pages, cnt, false);
+
+  lock_acquire (&swap_lock);
+  bitmap_set_multiple (swap_bitmap, slot, cnt, false);
+  for (i = 0; i < cnt; i++)
+    {
+      swap_owners[slot + i] = NULL;
+      pages[i]->sector = (block_sector_t) -1;
+    }
+  lock_release (&swap_lock);
+}
+
+/* Swaps out page P, which must have a locked frame. */
+bool
+swap_out (struct page *p)
+{
+  return swap_out_cluster (&p, 1) == 1;
+}
+
+/* Swaps out the CNT pages in PAGES, each of which must have a
+   locked frame, into consecutive swap slots where possible.
+   Returns the number of pages written, which are always the
+   first ones in PAGES; fewer than CNT only if swap is full. */
+size_t
+swap_out_cluster (struct page *pages[], size_t cnt)
+{
+  size_t done = 0;
+
+  ASSERT (cnt <= SWAP_CLUSTER);
+  while (done < cnt)
+    {
+      size_t run = cnt - done;
+      size_t slot;
+      size_t i;
+
+      /* Find free slots for as many of the remaining pages as
+         possible, halving the run until it fits. */
+      lock_acquire (&swap_lock);
+      for (;;)
+        {
+          slot = bitmap_scan_and_flip (swap_bitmap, 0, run, false);
+          if (slot != BITMAP_ERROR || run == 1)
+            break;
+          run /= 2;
+        }
+      if (slot != BITMAP_ERROR)
+        for (i = 0; i < run; i++)
+          swap_owners[slot + i] = pages[done + i];
+      lock_release (&swap_lock);
+      if (slot == BITMAP_ERROR)
+        break;
+
+      for (i = 0; i < run; i++)
+        pages[done + i]->sector = (slot + i) * PAGE_SECTORS;
+      transfer_cluster (pages + done, run, true);
+      for (i = 0; i < run; i++)
+        {
+          struct page *p = pages[done + i];
+          p->private = false;
+          p->file = NULL;
+          p->file_offset = 0;
+          p->file_bytes = 0;
+        }
+      done += run;
+    }
+  return done;
+}
+
+/* Returns true if page Q, found in swap slot SLOT, may be read
+   in together with page P: it must belong to the same process,
+   lie within SWAP_CLUSTER pages of P, and not be resident.
+   Must be called with swap_lock held. */
+static bool
+is_neighbor (struct page *p, size_t slot)
+{
+  struct page *q;
+  uintptr_t distance;
+
+  if (slot >= bitmap_size (swap_bitmap) || !bitmap_test (swap_bitmap, slot))
+    return false;
+  q = swap_owners[slot];
+  if (q == NULL || q->thread != p->thread || q->frame != NULL
+      || q->sector != slot * PAGE_SECTORS)
+    return false;
+  distance = (q->addr > p->addr
+              ? (uintptr_t) q->addr - (uintptr_t) p->addr
+              : (uintptr_t) p->addr - (uintptr_t) q->addr);
+  return distance < SWAP_CLUSTER * PGSIZE;
+}
+
+/* Finds pages worth reading in along with page P, which must be
+   swapped out and belong to the current process.  Stores into
+   PAGES, in swap slot order, the run of up to MAX pages in
+   consecutive slots around P's that were evicted from the same
+   region of the same process.  Slots after P's are preferred,
+   since they were evicted together with P.  Stores P's index in
+   PAGES into *IDX and returns the number of pages stored, which
+   is at least 1. */
+size_t
+swap_neighbors (struct page *p, struct page *pages[], size_t max,
+                size_t *idx)
+{
+  size_t slot, first, last;
+  size_t i;
+
+  ASSERT (p->sector != (block_sector_t) -1);
+  ASSERT (max > 0);
+
+  slot = first = last = p->sector / PAGE_SECTORS;
+  lock_acquire (&swap_lock);
+  while (last - first + 1 < max && is_neighbor (p, last + 1))
+    last++;
+  while (last - first + 1 < max && first > 0 && is_neighbor (p, first - 1))
+    first--;
+  for (i = first; i <= last; i++)
+    pages[i - first] = i == slot ? p : swap_owners[i];
+  lock_release (&swap_lock);
+
+  *idx = slot - first;
+  return last - first + 1;
+}
+
+/* Releases the swap slot held by page P, if any, discarding its
+   contents.  Used when P is destroyed without being swapped in. */
+void
+swap_discard (struct page *p)
+{
+  if (p->sector != (block_sector_t) -1)
+    {
+      size_t slot = p->sector / PAGE_SECTORS;
+
+      lock_acquire (&swap_lock);
+      bitmap_reset (swap_bitmap, slot);
+      swap_owners[slot] = NULL;
+      lock_release (&swap_lock);
+      p->sector = (block_sector_t) -1;
+    }
+}
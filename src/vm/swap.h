@@ -0,0 +1,20 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Most pages moved to or from swap in a single transfer. */
+#define SWAP_CLUSTER 8
+
+struct page;
+void swap_init (void);
+void swap_in (struct page *);
+void swap_in_cluster (struct page *[], size_t cnt);
+bool swap_out (struct page *);
+size_t swap_out_cluster (struct page *[], size_t cnt);
+size_t swap_neighbors (struct page *, struct page *[], size_t max,
+                       size_t *idx);
+void swap_discard (struct page *);
+
+#endif /* vm/swap.h */
@@ -0,0 +1,363 @@
+#include "vm/zswap.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed pages are kept in "arenas", pages obtained from the
+   kernel pool that are divided into CHUNK_SIZE-byte chunks.  The
+   first chunk of each arena holds its header, and each compressed
+   page occupies a run of consecutive chunks in a single arena.
+
+   Pages are compressed with a small LZ77 coder in the style of
+   LZ4: a sequence of literal bytes followed by a back-reference
+   to earlier output, repeated, with lengths packed into a token
+   byte.  It is not as tight as other compressors, but it is fast
+   enough that compressing and decompressing a page costs much
+   less than a PIO disk transfer. */
+
+/* Size of a chunk of arena, in bytes. */
+#define CHUNK_SIZE 256
+
+/* Number of chunks in an arena, including the header. */
+#define ARENA_CHUNKS (PGSIZE / CHUNK_SIZE)
+
+/* Most chunks that a compressed page may occupy.  Pages that
+   compress worse than this go to the swap device instead. */
+#define MAX_CHUNKS (ARENA_CHUNKS * 3 / 4)
+
+/* An arena of compressed pages. */
+struct arena
+  {
+    struct list_elem elem;      /* Element in `arenas'. */
+    uint32_t used;              /* Bitmap of chunks in use. */
+  };
+
+/* Arenas, and the number in use and allowed. */
+static struct list arenas;
+static size_t arena_cnt;
+static size_t arena_max;
+
+/* Protects the arenas and the compressor's work areas. */
+static struct lock zswap_lock;
+
+/* Shortest back-reference worth encoding. */
+#define MIN_MATCH 4
+
+/* Hash table of positions of recent 4-byte sequences, plus one,
+   so that 0 means "none".  Kept out of the kernel stack, which
+   is too small for it. */
+#define HASH_BITS 10
+static uint16_t hash_table[1 << HASH_BITS];
+
+/* Compressor output buffer. */
+static uint8_t out_buf[MAX_CHUNKS * CHUNK_SIZE];
+
+/* Sets up compressed swap, using at most 1/16 of memory. */
+void
+zswap_init (void)
+{
+  list_init (&arenas);
+  arena_max = init_ram_pages / 16;
+  lock_init (&zswap_lock);
+}
+
+/* Returns the 4 bytes starting at P as an integer. */
+static inline uint32_t
+read32 (const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* Returns the hash table index for 4-byte sequence V. */
+static inline unsigned
+hash_seq (uint32_t v)
+{
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Appends LENGTH, in the encoding used for lengths that do not
+   fit in a token nibble, to DST at *OP. */
+static void
+put_length (uint8_t *dst, size_t *op, size_t length)
+{
+  for (; length >= 255; length -= 255)
+    dst[(*op)++] = 255;
+  dst[(*op)++] = length;
+}
+
+/* Appends to DST at *OP a sequence of the LIT_LEN bytes at LIT
+   followed by a back-reference of MATCH_LEN bytes starting
+   OFFSET bytes back, or no back-reference if MATCH_LEN is 0.
+   Returns true if successful, false if the sequence would
+   extend DST past DST_MAX bytes. */
+static bool
+put_sequence (uint8_t *dst, size_t *op, size_t dst_max,
+              const uint8_t *lit, size_t lit_len,
+              size_t offset, size_t match_len)
+{
+  size_t match_code = match_len > 0 ? match_len - MIN_MATCH : 0;
+  size_t worst = 1 + lit_len / 255 + 1 + lit_len + 2 + match_code / 255 + 1;
+
+  if (*op + worst > dst_max)
+    return false;
+
+  dst[(*op)++] = ((lit_len < 15 ? lit_len : 15) << 4
+                  | (match_code < 15 ? match_code : 15));
+  if (lit_len >= 15)
+    put_length (dst, op, lit_len - 15);
+  memcpy (dst + *op, lit, lit_len);
+  *op += lit_len;
+
+  if (match_len > 0)
+    {
+      dst[(*op)++] = offset & 0xff;
+      dst[(*op)++] = offset >> 8;
+      if (match_code >= 15)
+        put_length (dst, op, match_code - 15);
+    }
+  return true;
+}
+
+/* Compresses the PGSIZE bytes at SRC into DST.  Returns the
+   compressed size, or 0 if it would exceed DST_MAX bytes.
+   Must be called with zswap_lock held. */
+static size_t
+compress (const uint8_t *src, uint8_t *dst, size_t dst_max)
+{
+  size_t ip = 0, anchor = 0, op = 0;
+
+  memset (hash_table, 0, sizeof hash_table);
+  while (ip + MIN_MATCH <= PGSIZE)
+    {
+      uint32_t v = read32 (src + ip);
+      unsigned h = hash_seq (v);
+      size_t ref = hash_table[h];
+
+      hash_table[h] = ip + 1;
+      if (ref != 0 && read32 (src + ref - 1) == v)
+        {
+          size_t len = MIN_MATCH;
+
+          ref--;
+          while (ip + len < PGSIZE && src[ref + len] == src[ip + len])
+            len++;
+          if (!put_sequence (dst, &op, dst_max, src + anchor, ip - anchor,
+                             ip - ref, len))
+            return 0;
+          ip += len;
+          anchor = ip;
+        }
+      else
+        ip++;
+    }
+
+  if (!put_sequence (dst, &op, dst_max, src + anchor, PGSIZE - anchor,
+                     0, 0))
+    return 0;
+  return op;
+}
+
+/* Reads a length extension from SRC at *IP, which may not go
+   past SIZE bytes, and adds it to *LENGTH.
+   Returns true if successful, false if SRC is malformed. */
+static bool
+get_length (const uint8_t *src, size_t *ip, size_t size, size_t *length)
+{
+  uint8_t b;
+
+  do
+    {
+      if (*ip >= size)
+        return false;
+      b = src[(*ip)++];
+      *length += b;
+    }
+  while (b == 255);
+  return true;
+}
+
+/* Decompresses the SIZE bytes at SRC, produced by compress(),
+   into the PGSIZE bytes at DST.
+   Returns true if successful, false if SRC is malformed. */
+static bool
+decompress (const uint8_t *src, size_t size, uint8_t *dst)
+{
+  size_t ip = 0, op = 0;
+
+  for (;;)
+    {
+      size_t lit_len, match_len, offset;
+      uint8_t token;
+
+      /* Literals. */
+      if (ip >= size)
+        return false;
+      token = src[ip++];
+      lit_len = token >> 4;
+      if (lit_len == 15 && !get_length (src, &ip, size, &lit_len))
+        return false;
+      if (lit_len > size - ip || lit_len > PGSIZE - op)
+        return false;
+      memcpy (dst + op, src + ip, lit_len);
+      ip += lit_len;
+      op += lit_len;
+
+      /* The last sequence has no back-reference. */
+      if (ip == size)
+        return op == PGSIZE;
+
+      /* Back-reference, which may overlap its own output. */
+      if (size - ip < 2)
+        return false;
+      offset = src[ip] | (src[ip + 1] << 8);
+      ip += 2;
+      match_len = token & 15;
+      if (match_len == 15 && !get_length (src, &ip, size, &match_len))
+        return false;
+      match_len += MIN_MATCH;
+      if (offset == 0 || offset > op || match_len > PGSIZE - op)
+        return false;
+      for (; match_len > 0; match_len--, op++)
+        dst[op] = dst[op - offset];
+    }
+}
+
+/* Returns a mask of CNT chunks starting at chunk IDX. */
+static inline uint32_t
+chunk_mask (size_t idx, size_t cnt)
+{
+  return ((1u << cnt) - 1) << idx;
+}
+
+/* Allocates CNT consecutive chunks in arena A.  Returns the
+   first chunk, or a null pointer if A has no such run. */
+static void *
+take_chunks (struct arena *a, size_t cnt)
+{
+  size_t i;
+
+  for (i = 1; i + cnt <= ARENA_CHUNKS; i++)
+    if ((a->used & chunk_mask (i, cnt)) == 0)
+      {
+        a->used |= chunk_mask (i, cnt);
+        return (uint8_t *) a + i * CHUNK_SIZE;
+      }
+  return NULL;
+}
+
+/* Allocates CNT consecutive chunks, adding an arena if necessary
+   and allowed.  Returns the first chunk, or a null pointer if no
+   space is available.
+   Must be called with zswap_lock held. */
+static void *
+alloc_chunks (size_t cnt)
+{
+  struct list_elem *e;
+  struct arena *a;
+
+  for (e = list_begin (&arenas); e != list_end (&arenas);
+       e = list_next (e))
+    {
+      void *data = take_chunks (list_entry (e, struct arena, elem), cnt);
+      if (data != NULL)
+        return data;
+    }
+
+  if (arena_cnt >= arena_max)
+    return NULL;
+  a = palloc_get_page (0);
+  if (a == NULL)
+    return NULL;
+  a->used = chunk_mask (0, 1);
+  list_push_back (&arenas, &a->elem);
+  arena_cnt++;
+  return take_chunks (a, cnt);
+}
+
+/* Frees the CNT chunks starting at DATA, and their arena if it
+   becomes empty.
+   Must be called with zswap_lock held. */
+static void
+free_chunks (void *data, size_t cnt)
+{
+  struct arena *a = pg_round_down (data);
+
+  a->used &= ~chunk_mask (pg_ofs (data) / CHUNK_SIZE, cnt);
+  if (a->used == chunk_mask (0, 1))
+    {
+      list_remove (&a->elem);
+      palloc_free_page (a);
+      arena_cnt--;
+    }
+}
+
+/* Tries to compress page P, which must have a locked frame, into
+   memory.  Returns true if successful, false if the page does
+   not compress well or there is no room, in which case it should
+   go to the swap device instead. */
+bool
+zswap_out (struct page *p)
+{
+  size_t size = 0;
+  void *data = NULL;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->zdata == NULL);
+
+  lock_acquire (&zswap_lock);
+  if (arena_max > 0)
+    {
+      size = compress (p->frame->base, out_buf, sizeof out_buf);
+      if (size > 0)
+        data = alloc_chunks (DIV_ROUND_UP (size, CHUNK_SIZE));
+      if (data != NULL)
+        memcpy (data, out_buf, size);
+    }
+  lock_release (&zswap_lock);
+  if (data == NULL)
+    return false;
+
+  p->zdata = data;
+  p->zsize = size;
+  p->file = NULL;
+  p->file_offset = 0;
+  p->file_bytes = 0;
+  return true;
+}
+
+/* Decompresses page P, which must have a locked frame and have
+   been compressed by zswap_out(), into its frame. */
+void
+zswap_in (struct page *p)
+{
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->zdata != NULL);
+
+  if (!decompress (p->zdata, p->zsize, p->frame->base))
+    PANIC ("corrupt compressed page at %p", p->addr);
+  zswap_discard (p);
+}
+
+/* Releases the compressed copy of page P, if any. */
+void
+zswap_discard (struct page *p)
+{
+  if (p->zdata != NULL)
+    {
+      lock_acquire (&zswap_lock);
+      free_chunks (p->zdata, DIV_ROUND_UP (p->zsize, CHUNK_SIZE));
+      lock_release (&zswap_lock);
+      p->zdata = NULL;
+      p->zsize = 0;
+    }
+}
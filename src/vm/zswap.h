@@ -0,0 +1,14 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+
+/* Compressed in-memory swap, tried before the swap device. */
+
+struct page;
+void zswap_init (void);
+bool zswap_out (struct page *);
+void zswap_in (struct page *);
+void zswap_discard (struct page *);
+
+#endif /* vm/zswap.h */